@@ -0,0 +1,35 @@
+/* File: allocstats.cc
+ * -------------------
+ * The global operator new and delete for dcc, which count each
+ * thread's allocations for --time-report and --trace (see timing.h).
+ * Only dcc links this in; libdecaf leaves the allocator alone.
+ */
+
+#include <new>
+#include <stdlib.h>
+#include "timing.h"
+
+static bool counting = (allocationsCounted = true);
+
+void *operator new(size_t size)
+{
+    CountAllocation(size);
+    if (size == 0) size = 1;
+    for (;;) {
+        void *p = malloc(size);
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept           { free(p); }
+void operator delete[](void *p) noexcept         { free(p); }
+void operator delete(void *p, size_t) noexcept   { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
@@ -0,0 +1,46 @@
+/* File: arena.cc
+ * --------------
+ * Chunk management for the Arena class.
+ */
+
+#include "arena.h"
+#include <cstdlib>
+#include "utility.h"
+
+/* Method: AllocateFromNewChunk
+ * ----------------------------
+ * Called when the current chunk can't fit size bytes. Requests bigger
+ * than a quarter chunk get a chunk of their own, so the space left in
+ * the current one isn't thrown away for them.
+ */
+void *Arena::AllocateFromNewChunk(size_t size)
+{
+    size_t header = (sizeof(Chunk) + Alignment - 1) & ~(Alignment - 1);
+    bool ownChunk = (size > ChunkSize/4);
+    size_t bytes = header + (ownChunk ? size : ChunkSize);
+    Chunk *c = (Chunk *)malloc(bytes);
+    Assert(c != NULL);
+    char *start = (char *)c + header;
+    if (ownChunk && chunks) {   // keep bumping through the current chunk
+        c->prev = chunks->prev;
+        chunks->prev = c;
+        return start;
+    }
+    c->prev = chunks;
+    chunks = c;
+    next = start + size;
+    limit = (char *)c + bytes;
+    return start;
+}
+
+void Arena::Release()
+{
+    for (; owned; owned = owned->prev)
+        owned->destroy(owned->object);
+    while (chunks) {
+        Chunk *prev = chunks->prev;
+        free(chunks);
+        chunks = prev;
+    }
+    next = limit = NULL;
+}
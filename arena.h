@@ -0,0 +1,79 @@
+/* File: arena.h
+ * -------------
+ * An Arena hands out memory by bumping a pointer through large chunks
+ * and gives it all back in one step, so a phase of the compiler that
+ * makes many small objects pays for a few mallocs instead of one per
+ * object, and everything the phase made goes away together once the
+ * next phase no longer needs it.
+ *
+ * Nothing in an arena is freed or destructed on its own. Only objects
+ * that own no other heap memory (no std containers) belong in one,
+ * and no pointer into an arena may outlive its Release. An object that
+ * does own some can be handed to the arena with Own, which deletes it
+ * at Release, so it still goes away with everything else.
+ *
+ * Objects are placed in an arena with the new (arena) form:
+ *
+ *   Location *loc = new (arena) Location(fpRelative, -8, arena.Strdup(name));
+ */
+
+#ifndef _H_arena
+#define _H_arena
+
+#include <cstddef>
+#include <cstring>
+
+class Arena
+{
+  public:
+    Arena() : chunks(NULL), next(NULL), limit(NULL), owned(NULL) {}
+    ~Arena() { Release(); }
+
+          // Returns size bytes aligned for any object we put in here
+    void *Allocate(size_t size) {
+        size = (size + Alignment - 1) & ~(Alignment - 1);
+        if (size > (size_t)(limit - next)) return AllocateFromNewChunk(size);
+        void *result = next;
+        next += size;
+        return result;
+    }
+    char *Strdup(const char *s) {
+        size_t len = strlen(s) + 1;
+        return (char *)memcpy(Allocate(len), s, len);
+    }
+
+          // Deletes object at Release (most recently owned first)
+    template <class T> T *Own(T *object) {
+        Owned *o = (Owned *)Allocate(sizeof(Owned));
+        o->prev = owned;
+        o->destroy = &Delete<T>;
+        o->object = object;
+        owned = o;
+        return object;
+    }
+
+          // Frees everything at once. The arena can be used again after.
+    void Release();
+
+  private:
+    static const size_t Alignment = 8;
+    static const size_t ChunkSize = 64*1024;
+
+    struct Chunk { Chunk *prev; };
+    Chunk *chunks;        // most recent first
+    char *next, *limit;   // free space left in the current chunk
+
+    struct Owned { Owned *prev; void (*destroy)(void *); void *object; };
+    Owned *owned;         // most recent first
+
+    template <class T> static void Delete(void *object) { delete (T *)object; }
+    void *AllocateFromNewChunk(size_t size);
+
+    Arena(const Arena&);            // not copyable
+    void operator=(const Arena&);
+};
+
+inline void *operator new(size_t size, Arena& arena) { return arena.Allocate(size); }
+inline void operator delete(void *, Arena&) {}
+
+#endif
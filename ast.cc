@@ -9,46 +9,75 @@
 #include <stdio.h>  // printf
 #include "errors.h"
 #include "scope.h"
+#include "intern.h"
+
+thread_local Arena *Node::arena = NULL;
+thread_local std::vector<yyltype*> Node::locationBlocks;
+thread_local int Node::numLocations = 0;
+
+void *Node::operator new(size_t size) {
+    return arena ? arena->Allocate(size) : ::operator new(size);
+}
+
+char *Node::CopyString(const char *s) {
+    return arena ? arena->Strdup(s) : strdup(s);
+}
+
+/* Method: ReleaseTree
+ * -------------------
+ * Frees the tree being built along with its locations. Nodes made
+ * after this go on the heap.
+ */
+void Node::ReleaseTree() {
+    if (arena) arena->Release();
+    arena = NULL;
+    locationBlocks.clear();
+    numLocations = 0;
+}
+
+int Node::AddLocation(const yyltype& loc) {
+    if (numLocations == (int)locationBlocks.size() * LocationBlockSize) {
+        size_t size = LocationBlockSize * sizeof(yyltype);
+        void *block = arena ? arena->Allocate(size) : ::operator new(size);
+        locationBlocks.push_back((yyltype *)block);
+    }
+    *LocationAt(numLocations) = loc;
+    return numLocations++;
+}
 
 Node::Node(yyltype loc) {
-    location = new yyltype(loc);
     parent = NULL;
-    nodeScope = NULL;
+    location = AddLocation(loc);
 }
 
 Node::Node() {
-    location = NULL;
     parent = NULL;
-    nodeScope = NULL;
+    location = NoLocation;
 }
 
-Decl *Node::FindDecl(Identifier *idToFind, lookup l) {
-    Decl *mine;
-    if (!nodeScope) PrepareScope();
-    if (nodeScope && (mine = nodeScope->Lookup(idToFind)))
-        return mine;
-    if (l == kDeep && parent)
-        return parent->FindDecl(idToFind, l);
-    return NULL;
-}
 	 
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
-    name = strdup(n);
+    name = Intern(n);
     cached = NULL;
 } 
 
- 
+void Identifier::Bind(ScopeStack *scopes) {
+    cached = scopes->Lookup(this);
+}
+
+/* Method: GetDeclRelativeToBase
+ * -----------------------------
+ * With no base, the decl the binding pass found (if any). With a base,
+ * the field of that name in the base's class or interface.
+ */
 Decl *Identifier::GetDeclRelativeToBase(Type *baseType)
 {
-    if (!cached) {
-        if (!baseType)
-            cached = FindDecl(this);
-        else if (!baseType->IsNamedType())
+    if (!cached && baseType) {
+        if (!baseType->IsNamedType())
             return NULL; // only classes are aggregates
-        else {
-            Decl *cd = dynamic_cast<NamedType*>(baseType)->GetDeclForType(); 
-            cached = (cd ? cd->FindDecl(this, kShallow) : NULL);
-        }
+        Decl *cd = dynamic_cast<NamedType*>(baseType)->GetDeclForType(); 
+        Scope *fields = (cd ? cd->PrepareScope() : NULL);
+        cached = (fields ? fields->Lookup(this) : NULL);
     } 
     return cached;
   }
@@ -10,6 +10,9 @@
  * file), that location can be NULL for those nodes that don't care/use 
  * locations. The location is typcially set by the node constructor.  The 
  * location is used to provide the context when reporting semantic errors.
+ * Since it is only read then, the node keeps just a 32-bit index and the
+ * locations themselves sit apart in a flat table, so the nodes the passes
+ * walk are packed together rather than interleaved with them.
  *
  * Parent: Each node has a pointer to its parent. For a Program node, the 
  * parent is NULL, for all other nodes it is the pointer to the node one level
@@ -18,7 +21,22 @@
  * instead we wait until assigning the children into the parent node and then 
  * set up links in both directions. The parent link is typically not used 
  * during parsing, but is more important in later phases.
-
+ *
+ * Binding: Before anything is checked, a binding pass (Bind) walks the
+ * tree once with a ScopeStack (see scope.h) holding the scopes open at
+ * each point, and every identifier naming a variable, function or type
+ * is resolved and remembers its declaration. Checking and code
+ * generation just use what was found. Only names looked up in some
+ * object (o.f, o.m()) wait until the type of the object is known, and
+ * those search the one class or interface scope.
+ *
+ * Allocation: While Node::arena is set, nodes, their locations and the
+ * strings they copy are all made in that arena (see arena.h), and the
+ * whole tree is released in one step (ReleaseTree) once code generation
+ * has turned it into TAC. Nodes made with no arena set (the built-in
+ * types) live on the heap for good. Names are interned instead (see
+ * intern.h). The arena and the location table are per thread, so
+ * compilations on different threads each build their own tree.
  */
 
 #ifndef _H_ast
@@ -26,8 +44,11 @@
 
 #include <stdlib.h>   // for NULL
 #include "location.h"
+#include "arena.h"
 #include <iostream>
+#include <vector>
 class Scope;
+class ScopeStack;
 class Decl;
 class Identifier;
 class Type;
@@ -36,21 +57,31 @@ class CodeGenerator;
 class Node 
 {
   protected:
-    yyltype *location;
     Node *parent;
-    Scope *nodeScope;
+    int location;           // index in the location table, or NoLocation
 
   public:
+    static thread_local Arena *arena;  // for the tree being built, if any
+
+    void *operator new(size_t size);
+    void operator delete(void *p) {} // nodes are never freed one by one
+    static char *CopyString(const char *s);
+    static void ReleaseTree();
+          // For what the tree keeps that owns heap memory of its own
+          // (scopes, nodes with std containers): deleted with the tree
+    template <class T> static T *OwnedByTree(T *object)
+        { if (arena) arena->Own(object); return object; }
+
     Node(yyltype loc);
     Node();
+    virtual ~Node() {}      // only run for nodes the tree owns, see above
     
-    yyltype *GetLocation()   { return location; }
+    yyltype *GetLocation()   { return location == NoLocation ? NULL : LocationAt(location); }
     void SetParent(Node *p)  { parent = p; }
     Node *GetParent()        { return parent; }
+    virtual void Bind(ScopeStack *scopes) {} // nodes naming nothing skip this
     virtual void Check() {} // not abstract, since some nodes have nothing to do
     
-    typedef enum { kShallow, kDeep } lookup;
-    virtual Decl *FindDecl(Identifier *id, lookup l = kDeep);
     virtual Scope *PrepareScope() { return NULL; }
     template <class Specific> Specific *FindSpecificParent() {
         Node *p = parent;
@@ -62,19 +93,35 @@ class Node
     }
 	 
     virtual void Emit(CodeGenerator *cg) {} // not abstract, some nodes do nothing
+
+  private:
+    static const int NoLocation = -1;
+    static const int LocationBlockBits = 10;
+    static const int LocationBlockSize = 1 << LocationBlockBits;
+
+          // The table grows by whole blocks, so a location never moves
+    static thread_local std::vector<yyltype*> locationBlocks;
+    static thread_local int numLocations;
+
+    static int AddLocation(const yyltype& loc);
+    static yyltype *LocationAt(int index) {
+        return &locationBlocks[index >> LocationBlockBits][index & (LocationBlockSize - 1)];
+    }
+    friend class FlatTree;  // keeps the locations of its nodes here too
 };
    
 
 class Identifier : public Node 
 {
   protected:
-    char *name;
+    const char *name;   // interned, compare with ==
     Decl *cached;
     
   public:
     Identifier(yyltype loc, const char *name);
     friend std::ostream& operator<<(std::ostream& out, Identifier *id) { return out << id->name; }
     const char *GetName() { return name; }
+    void Bind(ScopeStack *scopes);
     Decl *GetDeclRelativeToBase(Type *base = NULL);
 };
 
@@ -9,6 +9,8 @@
 #include "errors.h"
 #include "scanner.h" // for MaxIdentLen
 #include "codegen.h"
+#include "intern.h"
+#include "flatast.h"
         
          
 Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
@@ -28,6 +30,10 @@ VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
     (type=t)->SetParent(this);
 }
   
+void VarDecl::Bind(ScopeStack *scopes) {
+    type->Bind(scopes);
+    type = type->Canonical();
+}
 void VarDecl::Check() { type->Check(); if (type->IsError()) type = Type::errorType; }
 bool VarDecl::IsIvarDecl() { return dynamic_cast<ClassDecl*>(parent) != NULL;}
 void VarDecl::Emit(CodeGenerator *cg) { 
@@ -45,21 +51,30 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
     if (extends) extends->SetParent(this);
     (implements=imp)->SetParentAll(this);
     (members=m)->SetParentAll(this);
+    nodeScope = NULL;
     cType = new NamedType(n);
     cType->SetParent(this);
     convImp = NULL;
     vtable = new List<const char*>;
     nextIvarOffset = 4;
+    superclass = NULL;
+    subclasses = new List<ClassDecl*>;
+    firstInTree = lastInTree = -1;
+    OwnedByTree(this); // for interfaces
 }
 
-void ClassDecl::Check() {
-   if (extends) {
-        ClassDecl *pd = dynamic_cast<ClassDecl*>(parent->FindDecl(extends->GetId()));
-        List<Decl*> *pm = pd->members;
-        for (int i = 0; i < pm->NumElements(); i++)
-	    ;//AddField(pm->Nth(i), NULL);
-    }
+// The class names in the header are taken from the global scope, the
+// members see the class scope (inherited fields included) on top of it.
+void ClassDecl::Bind(ScopeStack *scopes) {
+    if (extends) extends->Bind(scopes);
+    implements->BindAll(scopes);
+    cType->Bind(scopes);
+    scopes->Push(PrepareScope());
+    members->BindAll(scopes);
+    scopes->Pop();
+}
 
+void ClassDecl::Check() {
     if (extends && !extends->IsClass()) {
         ReportError::IdentifierNotDeclared(extends->GetId(), LookingForClass);
         extends = NULL;
@@ -74,30 +89,41 @@ void ClassDecl::Check() {
     PrepareScope();
     members->CheckAll();
     for (int i = 0; i < convImp->NumElements(); i++) {
-        if (!convImp->Nth(i)->ClassMeetsObligation(nodeScope))
+        if (!convImp->Nth(i)->ClassMeetsObligation(this))
             ReportError::InterfaceNotImplemented(this, implements->Nth(i));
     }
 }
 
-// This is not done very cleanly. I should sit down and sort this out. Right now
-// I was using the copy-in strategy from the old compiler, but I think the link to
-// parent may be the better way now.
+/* Method: PrepareScope
+ * ---------------------
+ * The class scope links to the parent's scope rather than copying it,
+ * and the layout (ivar offsets, vtable) picks up where the parent's
+ * ends, so only this class's own members are visited.
+ */
 Scope *ClassDecl::PrepareScope()
 {
     if (nodeScope) return nodeScope;
-    nodeScope = new Scope();  
-    if (extends) {
-        ClassDecl *ext = dynamic_cast<ClassDecl*>(parent->FindDecl(extends->GetId())); 
-        if (ext) nodeScope->CopyFromScope(ext->PrepareScope(), this);
+    nodeScope = OwnedByTree(new Scope());  
+    Scope *global = parent->PrepareScope();
+    ClassDecl *ext = NULL;
+    if (extends)
+        ext = dynamic_cast<ClassDecl*>(global->Lookup(extends->GetId())); 
+    if (ext) {
+        Scope *inherited = ext->PrepareScope();
+        if (ext->convImp) { // else ext is still being prepared: inheritance cycle
+            nodeScope->InheritFrom(inherited);
+            superclass = ext;
+            ext->subclasses->Append(this);
+            nextIvarOffset = ext->nextIvarOffset;
+            for (int i = 0; i < ext->vtable->NumElements(); i++)
+                vtable->Append(ext->vtable->Nth(i));
+        }
     }
     convImp = new List<InterfaceDecl*>;
     for (int i = 0; i < implements->NumElements(); i++) {
         NamedType *in = implements->Nth(i);
-        InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(in->FindDecl(in->GetId()));
-        if (id) {
-		nodeScope->CopyFromScope(id->PrepareScope(), NULL);
-            convImp->Append(id);
-	  }
+        InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(global->Lookup(in->GetId()));
+        if (id) convImp->Append(id);
     }
     for (int i = 0; i < members->NumElements(); i++) {
         AddField(members->Nth(i));
@@ -107,20 +133,44 @@ Scope *ClassDecl::PrepareScope()
 }
 
 
-bool ClassDecl::IsCompatibleWith(Type *other) {
-    if (Implements(other)) return true;
-    if (cType->IsEquivalentTo(other)) return true;
-    return (extends && extends->IsCompatibleWith(other));
+/* Method: NumberHierarchy
+ * -----------------------
+ * Numbers the classes in preorder over the inheritance forest, so the
+ * subclasses of a class (direct or not) are exactly the ones numbered
+ * from its firstInTree through its lastInTree. Each class also gets
+ * the set of every interface it implements, its superclasses' included.
+ * That lets IsCompatibleWith answer without walking up the hierarchy.
+ * Done once, after all class scopes have been prepared.
+ */
+void ClassDecl::NumberHierarchy(List<Decl*> *decls) {
+    int numInterfaces = 0, next = 0;
+    for (int i = 0; i < decls->NumElements(); i++) {
+        InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(decls->Nth(i));
+        if (id) id->SetNumber(numInterfaces++);
+    }
+    for (int i = 0; i < decls->NumElements(); i++) {
+        ClassDecl *cd = dynamic_cast<ClassDecl*>(decls->Nth(i));
+        if (cd && !cd->superclass) cd->NumberSubtree(&next, numInterfaces);
+    }
 }
 
-bool ClassDecl::Implements(Type *other) {
-    if (!other->IsNamedType()) return false;
-    Decl *toMatch = dynamic_cast<NamedType*>(other)->GetDeclForType();
-    if (!convImp) PrepareScope(); //jdz hack
-    for (int i = 0; i < convImp->NumElements(); i++) {
-        InterfaceDecl *id = convImp->Nth(i);
-        if (id == toMatch) return true;
-    }
+void ClassDecl::NumberSubtree(int *next, int numInterfaces) {
+    firstInTree = (*next)++;
+    interfaces = superclass ? superclass->interfaces : BitVector(numInterfaces);
+    for (int i = 0; i < convImp->NumElements(); i++)
+        interfaces.Insert(convImp->Nth(i)->GetNumber());
+    for (int i = 0; i < subclasses->NumElements(); i++)
+        subclasses->Nth(i)->NumberSubtree(next, numInterfaces);
+    lastInTree = *next - 1;
+}
+
+bool ClassDecl::IsCompatibleWith(Type *other) {
+    Assert(firstInTree != -1);
+    Decl *d = other->IsNamedType() ? dynamic_cast<NamedType*>(other)->GetDeclForType() : NULL;
+    if (ClassDecl *cd = dynamic_cast<ClassDecl*>(d))
+        return cd->firstInTree <= firstInTree && firstInTree <= cd->lastInTree;
+    if (InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(d))
+        return interfaces.Contains(id->GetNumber());
     return false;
 }
 void ClassDecl::Emit(CodeGenerator *cg) {
@@ -165,6 +215,18 @@ void ClassDecl::AddMethod(FnDecl *decl, Decl *inherited) {
 InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
     Assert(n != NULL && m != NULL);
     (members=m)->SetParentAll(this);
+    nodeScope = NULL;
+    iType = new NamedType(n);
+    iType->SetParent(this);
+    number = -1;
+    OwnedByTree(this); // for meetsObligation
+}
+
+void InterfaceDecl::Bind(ScopeStack *scopes) {
+    iType->Bind(scopes);
+    scopes->Push(PrepareScope());
+    members->BindAll(scopes);
+    scopes->Pop();
 }
 
 void InterfaceDecl::Check() {
@@ -174,18 +236,28 @@ void InterfaceDecl::Check() {
   
 Scope *InterfaceDecl::PrepareScope() {
     if (nodeScope) return nodeScope;
-    nodeScope = new Scope();  
+    nodeScope = OwnedByTree(new Scope());  
     members->DeclareAll(nodeScope);
     return nodeScope;
 }
-bool InterfaceDecl::ClassMeetsObligation(Scope *s) {
-    for (int i = 0; i < members->NumElements();i++) {
+
+/* Method: ClassMeetsObligation
+ * ----------------------------
+ * Whether the class declares or inherits a matching method for each
+ * of ours. Worked out once per class.
+ */
+bool InterfaceDecl::ClassMeetsObligation(ClassDecl *cd) {
+    std::map<ClassDecl*, bool>::iterator known = meetsObligation.find(cd);
+    if (known != meetsObligation.end())
+        return known->second;
+    Scope *s = cd->PrepareScope();
+    bool meets = true;
+    for (int i = 0; i < members->NumElements() && meets; i++) {
         FnDecl *m = dynamic_cast<FnDecl*>(members->Nth(i));
         FnDecl *found = dynamic_cast<FnDecl*>(s->Lookup(m->GetId()));
-        if (!found || !found->MatchesPrototype(m) || found->GetParent() == this)
-            return false;
+        meets = found && found->MatchesPrototype(m);
     }
-    return true;
+    return meetsObligation[cd] = meets;
 }
 	
 FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
@@ -193,19 +265,42 @@ FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
     (returnType=r)->SetParent(this);
     (formals=d)->SetParentAll(this);
     body = NULL;
+    flatTree = NULL;
+    flatBody = FlatTree::None;
+    nodeScope = NULL;
 }
 
 void FnDecl::SetFunctionBody(Stmt *b) { 
     (body=b)->SetParent(this);
 }
 
+void FnDecl::SetFlatBody(FlatTree *tree, int block) {
+    flatTree = tree;
+    flatBody = block;
+}
+
+void FnDecl::Bind(ScopeStack *scopes) {
+    returnType->Bind(scopes);
+    returnType = returnType->Canonical();
+    if (!body && !flatTree) {
+        formals->BindAll(scopes);
+        return;
+    }
+    nodeScope = OwnedByTree(new Scope());
+    formals->DeclareAll(nodeScope);
+    scopes->Push(nodeScope);
+    formals->BindAll(scopes);
+    if (body) body->Bind(scopes);
+    else flatTree->Bind(this, flatBody, scopes);
+    scopes->Pop();
+}
+
 void FnDecl::Check() {
     returnType->Check();
-    if (body) {
-        nodeScope = new Scope();
-        formals->DeclareAll(nodeScope);
+    if (body || flatTree) {
         formals->CheckAll();
-	body->Check();
+	if (body) body->Check();
+	else flatTree->Check(this, flatBody);
     }
 }
 
@@ -236,10 +331,11 @@ bool FnDecl::MatchesPrototype(FnDecl *other) {
 }
 
 void FnDecl::Emit(CodeGenerator *cg) {
-    if (body) {
+    if (body || flatTree) {
         cg->GenLabel(GetFunctionLabel());
         cg->GenBeginFunc(this);
-        body->Emit(cg);
+        if (body) body->Emit(cg);
+        else flatTree->Emit(this, flatBody, cg);
         cg->GenEndFunc();
         
     }
@@ -256,11 +352,11 @@ const char *FnDecl::GetFunctionLabel()
     if ((cd = dynamic_cast<ClassDecl*>(parent)) != NULL) { // if parent is a class, this is is a method
         char buffer[MaxIdentLen*2+4];
         sprintf(buffer, "_%s.%s", cd->GetName(), id->GetName());
-        return strdup(buffer);
-    } else if (strcmp(id->GetName(), "main")) {
+        return Intern(buffer);
+    } else if (id->GetName() != Intern("main")) {
 	 char buffer[strlen(id->GetName())+2];
 	 sprintf(buffer, "_%s", id->GetName());
-       return strdup(buffer);
+       return Intern(buffer);
     } else
 	return id->GetName();
 }
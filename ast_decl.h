@@ -11,6 +11,8 @@
 
 #include "ast.h"
 #include "list.h"
+#include "bitvector.h"
+#include <map>
 
 class Type;
 class NamedType;
@@ -20,6 +22,7 @@ class FnDecl;
 class InterfaceDecl;
 #include "ast_stmt.h"
 class Location;
+class FlatTree;
 
 class Decl : public Node 
 {
@@ -52,6 +55,7 @@ class VarDecl : public Decl
     
   public:
     VarDecl(Identifier *name, Type *type);
+    void Bind(ScopeStack *scopes);
     void Check();
     Type *GetDeclaredType() { return type; }
     bool IsVarDecl() { return true; }
@@ -65,21 +69,29 @@ class ClassDecl : public Decl
 {
   protected:
     List<Decl*> *members;
+    Scope *nodeScope;
     NamedType *extends;
     List<NamedType*> *implements;
     Type *cType;
     List<InterfaceDecl*> *convImp;
     List<const char*> *vtable;
     int nextIvarOffset;
+    ClassDecl *superclass;           // once the scope is prepared
+    List<ClassDecl*> *subclasses;
+    int firstInTree, lastInTree;     // see NumberHierarchy
+    BitVector interfaces;            // numbers of all interfaces implemented
+
+    void NumberSubtree(int *next, int numInterfaces);
 
   public:
     ClassDecl(Identifier *name, NamedType *extends, 
               List<NamedType*> *implements, List<Decl*> *members);
+    void Bind(ScopeStack *scopes);
     void Check();
     bool IsClassDecl() { return true; }
     Scope *PrepareScope();
+    static void NumberHierarchy(List<Decl*> *decls);
     bool IsCompatibleWith(Type *type);
-    bool Implements(Type *intf);
     Type *GetDeclaredType() { return cType; } //  used by "this"
     const char *GetClassName() { return id->GetName(); }
     void Emit(CodeGenerator *cg);
@@ -93,13 +105,21 @@ class InterfaceDecl : public Decl
 {
   protected:
     List<Decl*> *members;
+    Scope *nodeScope;
+    Type *iType;
+    int number;   // see ClassDecl::NumberHierarchy
+    std::map<ClassDecl*, bool> meetsObligation;
     
   public:
     InterfaceDecl(Identifier *name, List<Decl*> *members);
+    void Bind(ScopeStack *scopes);
     void Check();
     bool IsInterfaceDecl() { return true; }
+    Type *GetDeclaredType() { return iType; }
+    void SetNumber(int n) { number = n; }
+    int GetNumber() { return number; }
     Scope *PrepareScope();
-    bool ClassMeetsObligation(Scope *s);
+    bool ClassMeetsObligation(ClassDecl *cd);
 };
 
 class FnDecl : public Decl 
@@ -108,10 +128,15 @@ class FnDecl : public Decl
     List<VarDecl*> *formals;
     Type *returnType;
     Stmt *body;
+    FlatTree *flatTree;   // or, if the body was built flat (see flatast.h),
+    int flatBody;         // the tree and the body's block in it
+    Scope *nodeScope;
     
   public:
     FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
     void SetFunctionBody(Stmt *b);
+    void SetFlatBody(FlatTree *tree, int block);
+    void Bind(ScopeStack *scopes);
     void Check();
     bool IsFnDecl() { return true; }
     bool IsMethodDecl();
@@ -9,13 +9,14 @@
 
 #include "errors.h"
 #include "codegen.h"
+#include "intern.h"
 
-Type *EmptyExpr::CheckAndComputeResultType() { return Type::voidType; } 
+Type *EmptyExpr::ComputeResultType() { return Type::voidType; } 
 
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
     value = val;
 }
-Type *IntConstant::CheckAndComputeResultType() { 
+Type *IntConstant::ComputeResultType() { 
     return Type::intType;
 }
 void IntConstant::Emit(CodeGenerator *cg) { 
@@ -25,14 +26,14 @@ void IntConstant::Emit(CodeGenerator *cg) {
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
     value = val;
 }
-Type *DoubleConstant::CheckAndComputeResultType() { 
+Type *DoubleConstant::ComputeResultType() { 
     return Type::doubleType;
 }
 
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
     value = val;
 }
-Type *BoolConstant::CheckAndComputeResultType() { 
+Type *BoolConstant::ComputeResultType() { 
     return Type::boolType;
 }
 void BoolConstant::Emit(CodeGenerator *cg) { 
@@ -41,15 +42,15 @@ void BoolConstant::Emit(CodeGenerator *cg) {
 
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
     Assert(val != NULL);
-    value = strdup(val);
+    value = CopyString(val);
 }
-Type *StringConstant::CheckAndComputeResultType() {
+Type *StringConstant::ComputeResultType() {
     return Type::stringType;
 }
 void StringConstant::Emit(CodeGenerator *cg) { 
     result = cg->GenLoadConstant(value);
 }
-Type *NullConstant::CheckAndComputeResultType() { 
+Type *NullConstant::ComputeResultType() { 
     return Type::nullType;
 }
 void NullConstant::Emit(CodeGenerator *cg) { 
@@ -75,6 +76,10 @@ CompoundExpr::CompoundExpr(Operator *o, Expr *r)
     (op=o)->SetParent(this);
     (right=r)->SetParent(this);
 }
+void CompoundExpr::Bind(ScopeStack *scopes) {
+    if (left) left->Bind(scopes);
+    right->Bind(scopes);
+}
 void CompoundExpr::ReportErrorForIncompatibleOperands(Type *lhs, Type *rhs) {
     if (!lhs) { //unary op
         ReportError::IncompatibleOperand(op, rhs);
@@ -103,7 +108,7 @@ Type *GetResultType(Type *lhs, Type *rhs) {
     return lesser;
 }
 
-Type*ArithmeticExpr::CheckAndComputeResultType() {
+Type*ArithmeticExpr::ComputeResultType() {
     Type *lType = left?left->CheckAndComputeResultType():NULL, *rType = right->CheckAndComputeResultType();
     if (EitherOperandIsError(lType,rType)) return Type::errorType;
     if (GetResultType(lType, rType) == Type::errorType)
@@ -120,7 +125,7 @@ void ArithmeticExpr::Emit(CodeGenerator *cg) {
     }
 }
 
-Type* RelationalExpr::CheckAndComputeResultType() {
+Type* RelationalExpr::ComputeResultType() {
    Type*lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
    if (EitherOperandIsError(lhs,rhs)) return Type::boolType;
     if (!lhs->IsEquivalentTo(rhs) || !lhs->IsNumeric())
@@ -145,7 +150,7 @@ void RelationalExpr::Emit(CodeGenerator *cg) {
     }
 }
 
-Type* EqualityExpr::CheckAndComputeResultType() {
+Type* EqualityExpr::ComputeResultType() {
    Type*lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
     if (!lhs->IsCompatibleWith(rhs) && !rhs->IsCompatibleWith(lhs))
 	ReportErrorForIncompatibleOperands(lhs, rhs);
@@ -154,7 +159,7 @@ Type* EqualityExpr::CheckAndComputeResultType() {
 void EqualityExpr::Emit(CodeGenerator *cg) {
     left->Emit(cg);
     right->Emit(cg);
-    if (left->CheckAndComputeResultType() == Type::stringType) 
+    if (left->GetType() == Type::stringType) 
         result = cg->GenBuiltInCall(StringEqual, left->result, right->result);
     else
         result = cg->GenBinaryOp("==", left->result, right->result);
@@ -164,7 +169,7 @@ void EqualityExpr::Emit(CodeGenerator *cg) {
     }
 }
 
-Type* LogicalExpr::CheckAndComputeResultType() {
+Type* LogicalExpr::ComputeResultType() {
     Type *lhs = left ?left->CheckAndComputeResultType() :NULL, *rhs = right->CheckAndComputeResultType();
     if ((lhs && !lhs->IsCompatibleWith(Type::boolType)) ||
 	  (!rhs->IsCompatibleWith(Type::boolType)))
@@ -181,7 +186,7 @@ void LogicalExpr::Emit(CodeGenerator *cg) {
     }
 }
 
-Type * AssignExpr::CheckAndComputeResultType() {
+Type * AssignExpr::ComputeResultType() {
     Type *lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
     if (!rhs->IsCompatibleWith(lhs)) {
         ReportErrorForIncompatibleOperands(lhs, rhs);
@@ -204,7 +209,7 @@ Type * AssignExpr::CheckAndComputeResultType() {
     if (result->IsReference()) 
 	result = cg->GenLoad(result->GetBase(), result->GetRefOffset());
   }
-Type* This::CheckAndComputeResultType() {
+Type* This::ComputeResultType() {
     if (!enclosingClass) enclosingClass = FindSpecificParent<ClassDecl>();
    if (!enclosingClass)  
        ReportError::ThisOutsideClassScope(this);
@@ -223,7 +228,7 @@ ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
     (base=b)->SetParent(this); 
     (subscript=s)->SetParent(this);
 }
-Type *ArrayAccess::CheckAndComputeResultType() {
+Type *ArrayAccess::ComputeResultType() {
     Type *baseT = base->CheckAndComputeResultType();
     if ((baseT != Type::errorType) && !baseT->IsArrayType()) 
         ReportError::BracketsOnNonArray(base);
@@ -246,8 +251,14 @@ FieldAccess::FieldAccess(Expr *b, Identifier *f)
     (field=f)->SetParent(this);
 }
 
+// Without a base the field is a name in scope, bound now. With one it
+// can only be looked up once the type of the base is known.
+void FieldAccess::Bind(ScopeStack *scopes) {
+    if (base) base->Bind(scopes);
+    else field->Bind(scopes);
+}
 
-Type* FieldAccess::CheckAndComputeResultType() {
+Type* FieldAccess::ComputeResultType() {
     Type *baseType = base ? base->CheckAndComputeResultType() : NULL;
     Decl *ivar = field->GetDeclRelativeToBase(baseType);
     if (ivar && ivar->IsIvarDecl() && !base) { // add implicit "this"
@@ -277,11 +288,10 @@ Type* FieldAccess::CheckAndComputeResultType() {
   }
 
 void FieldAccess::EmitWithoutDereference(CodeGenerator *cg) {
-    CheckAndComputeResultType(); // need to ensure check called to get base set
-    Decl *fd = field->GetDeclRelativeToBase(base ? base->CheckAndComputeResultType() : NULL);
+    Decl *fd = field->GetDeclRelativeToBase(base ? base->GetType() : NULL);
     if (base) {
         base->Emit(cg);
-        result = new Location(base->result, fd->GetOffset());
+        result = cg->GenReference(base->result, fd->GetOffset());
     } else
         result = dynamic_cast<VarDecl*>(fd)->rtLoc;
 }
@@ -293,8 +303,13 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     (field=f)->SetParent(this);
     (actuals=a)->SetParentAll(this);
 }
+void Call::Bind(ScopeStack *scopes) {
+    if (base) base->Bind(scopes);
+    else field->Bind(scopes);
+    actuals->BindAll(scopes);
+}
 // special-case code for length() on arrays... sigh.
-Type* Call::CheckAndComputeResultType() {
+Type* Call::ComputeResultType() {
     Type *baseType = base ? base->CheckAndComputeResultType() : NULL;
     FnDecl *fd = dynamic_cast<FnDecl *>(field->GetDeclRelativeToBase(baseType));
     if (fd && fd->IsMethodDecl() && !base) { // add implicit "this"
@@ -307,7 +322,7 @@ Type* Call::CheckAndComputeResultType() {
         aTypes.Append(actuals->Nth(i)->CheckAndComputeResultType());
 // jdz cascade, above loop checks actuals before function confirmed.
 // what about excess actuals? what if function doesn't exist at all?
-    if (baseType && baseType->IsArrayType() && strcmp(field->GetName(), "length") == 0) {
+    if (baseType && baseType->IsArrayType() && field->GetName() == Intern("length")) {
 	if (actuals->NumElements() != 0) 
             ReportError::NumArgsMismatch(field, 0, actuals->NumElements());
 	return Type::intType;
@@ -338,7 +353,7 @@ Type* Call::CheckAndComputeResultType() {
 }
 void Call::Emit(CodeGenerator *cg)
 {
-    Type *baseType = base ? base->CheckAndComputeResultType() :NULL;
+    Type *baseType = base ? base->GetType() : NULL;
     if (baseType && baseType->IsArrayType()) { // assume length() (i.e. semantically correct)
 	base->Emit(cg);
 	result = cg->GenArrayLen(base->result);
@@ -349,7 +364,7 @@ void Call::Emit(CodeGenerator *cg)
 	actuals->Nth(i)->Emit(cg);
 	l.Append(actuals->Nth(i)->result);
     }
-    Type *resultType = CheckAndComputeResultType(); // force base to get set
+    Type *resultType = GetType();
     FnDecl *func = dynamic_cast<FnDecl *>(field->GetDeclRelativeToBase(baseType));
     if (base) {
         base->Emit(cg);
@@ -366,12 +381,15 @@ NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) {
   (cType=c)->SetParent(this);
 }
 
-Type* NewExpr::CheckAndComputeResultType() {
+void NewExpr::Bind(ScopeStack *scopes) {
+    cType->Bind(scopes);
+}
+Type* NewExpr::ComputeResultType() {
     if (!cType->IsClass()) {
         ReportError::IdentifierNotDeclared(cType->GetId(), LookingForClass);
         return Type::errorType;
     }
-    return cType; 
+    return cType->Canonical(); 
 }
 void NewExpr::Emit(CodeGenerator *cg) { 
     ClassDecl *cd = dynamic_cast<ClassDecl*>(cType->GetDeclForType());
@@ -383,13 +401,17 @@ NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
     (size=sz)->SetParent(this); 
     (elemType=et)->SetParent(this);
 }
-Type *NewArrayExpr::CheckAndComputeResultType() {
+void NewArrayExpr::Bind(ScopeStack *scopes) {
+    size->Bind(scopes);
+    elemType->Bind(scopes);
+    elemType = elemType->Canonical();
+}
+Type *NewArrayExpr::ComputeResultType() {
     Type *st = size->CheckAndComputeResultType();
     if (!st->IsCompatibleWith(Type::intType))
 	ReportError::NewArraySizeNotInteger(size);
     elemType->Check();
-    yyltype none;
-    return new ArrayType(none, elemType);
+    return elemType->ArrayOf();
 }
   
 void NewArrayExpr::Emit(CodeGenerator *cg) {
@@ -397,8 +419,8 @@ void NewArrayExpr::Emit(CodeGenerator *cg) {
     result = cg->GenNewArray(size->GetResult());
 }
 
-Type *ReadIntegerExpr::CheckAndComputeResultType() { return Type::intType; }
-Type *ReadLineExpr::CheckAndComputeResultType() { return Type::stringType; }
+Type *ReadIntegerExpr::ComputeResultType() { return Type::intType; }
+Type *ReadLineExpr::ComputeResultType() { return Type::stringType; }
 
 void ReadIntegerExpr::Emit(CodeGenerator *cg) {
     result = cg->GenBuiltInCall(ReadInteger);
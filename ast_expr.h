@@ -22,11 +22,19 @@ class Location;
 
 class Expr : public Stmt 
 {
+  protected:
+    Type *type;   // NULL until checked
+
   public:
-    Expr(yyltype loc) : Stmt(loc) { result = NULL; }
-    Expr() : Stmt() { result = NULL; }
+    Expr(yyltype loc) : Stmt(loc) { result = NULL; type = NULL; }
+    Expr() : Stmt() { result = NULL; type = NULL; }
     void Check() { CheckAndComputeResultType(); }
-    virtual Type* CheckAndComputeResultType() = 0;
+          // Works the type out (reporting any errors) on the first call
+          // only, later calls return the same Type
+    Type* CheckAndComputeResultType() { return type ? type : (type = ComputeResultType()); }
+          // The type found by Check, for code generation
+    Type *GetType() { Assert(type != NULL); return type; }
+    virtual Type* ComputeResultType() = 0;
     Location *result;
     Location *GetResult() { return result; }
 };
@@ -37,7 +45,7 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg) { result = NULL; }
 };
 
@@ -48,7 +56,7 @@ class IntConstant : public Expr
   
   public:
     IntConstant(yyltype loc, int val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -59,7 +67,7 @@ class DoubleConstant : public Expr
     
   public:
     DoubleConstant(yyltype loc, double val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
 };
 
 class BoolConstant : public Expr 
@@ -69,7 +77,7 @@ class BoolConstant : public Expr
     
   public:
     BoolConstant(yyltype loc, bool val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -80,7 +88,7 @@ class StringConstant : public Expr
     
   public:
     StringConstant(yyltype loc, const char *val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -88,7 +96,7 @@ class NullConstant: public Expr
 {
   public: 
     NullConstant(yyltype loc) : Expr(loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -112,17 +120,22 @@ class CompoundExpr : public Expr
   public:
     CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
     CompoundExpr(Operator *op, Expr *rhs);             // for unary
+    void Bind(ScopeStack *scopes);
     void ReportErrorForIncompatibleOperands(Type *lhs, Type *rhs);
     bool EitherOperandIsError(Type *lhs, Type *rhs);
     void Emit(CodeGenerator *cg);
 };
 
+      // The type of an arithmetic operation on these (lhs NULL if unary),
+      // errorType if they don't go together
+Type *GetResultType(Type *lhs, Type *rhs);
+
 class ArithmeticExpr : public CompoundExpr 
 {
   public:
     ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -130,7 +143,7 @@ class RelationalExpr : public CompoundExpr
 {
   public:
     RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -139,7 +152,7 @@ class EqualityExpr : public CompoundExpr
   public:
     EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -149,7 +162,7 @@ class LogicalExpr : public CompoundExpr
     LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -158,7 +171,7 @@ class AssignExpr : public CompoundExpr
   public:
     AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "AssignExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -177,7 +190,7 @@ class This : public Expr
     
   public:
     This(yyltype loc) : Expr(loc), enclosingClass(NULL)  {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
      void Emit(CodeGenerator *cg);
 };
 
@@ -188,7 +201,8 @@ class ArrayAccess : public LValue
     
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
-    Type *CheckAndComputeResultType();
+    void Bind(ScopeStack *scopes) { base->Bind(scopes); subscript->Bind(scopes); }
+    Type *ComputeResultType();
      void EmitWithoutDereference(CodeGenerator *cg);
 };
 
@@ -205,7 +219,8 @@ class FieldAccess : public LValue
     
   public:
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
-    Type* CheckAndComputeResultType();
+    void Bind(ScopeStack *scopes);
+    Type* ComputeResultType();
      void EmitWithoutDereference(CodeGenerator *cg);
 };
 
@@ -222,8 +237,9 @@ class Call : public Expr
     
   public:
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
+    void Bind(ScopeStack *scopes);
     Decl *GetFnDecl();
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -234,7 +250,8 @@ class NewExpr : public Expr
     
   public:
     NewExpr(yyltype loc, NamedType *clsType);
-    Type* CheckAndComputeResultType();
+    void Bind(ScopeStack *scopes);
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -246,7 +263,8 @@ class NewArrayExpr : public Expr
     
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
-    Type* CheckAndComputeResultType();
+    void Bind(ScopeStack *scopes);
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -254,7 +272,7 @@ class ReadIntegerExpr : public Expr
 {
   public:
     ReadIntegerExpr(yyltype loc) : Expr(loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -262,7 +280,7 @@ class ReadLineExpr : public Expr
 {
   public:
     ReadLineExpr(yyltype loc) : Expr (loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -9,23 +9,42 @@
 #include "scope.h"
 #include "errors.h"
 #include "codegen.h"
+#include "intern.h"
+#include "timing.h"
 
 
 Program::Program(List<Decl*> *d) {
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
+    nodeScope = NULL;
 }
 
-void Program::Check() {
-    nodeScope = new Scope();
+Scope *Program::PrepareScope() {
+    if (nodeScope) return nodeScope;
+    nodeScope = OwnedByTree(new Scope());
     decls->DeclareAll(nodeScope);
+    return nodeScope;
+}
+
+/* Method: Check
+ * -------------
+ * Resolves every name in the program in one pass over the tree, lays
+ * out the class hierarchy, then checks it.
+ */
+void Program::Check() {
+    PhaseTimer timer(CheckPhase);
+    ScopeStack scopes;
+    scopes.Push(PrepareScope());
+    decls->BindAll(&scopes);
+    scopes.Pop();
+    ClassDecl::NumberHierarchy(decls);
     decls->CheckAll();
 }
 void Program::Emit() {
     bool found = false;
     for (int i=0; i < decls->NumElements(); i++) {
 	Decl *d = decls->Nth(i);
-	if (!strcmp(d->GetName(), "main") && d->IsFnDecl()) {
+	if (d->GetName() == Intern("main") && d->IsFnDecl()) {
 	  found = true;
 	  break;
 	}
@@ -35,19 +54,34 @@ void Program::Emit() {
 	return;
     }
     CodeGenerator *cg = new CodeGenerator();
+    BeginPhase(TacPhase);
     decls->EmitAll(cg);
-    if (ReportError::NumErrors() == 0)
+    EndPhase(TacPhase);
+    if (ReportError::NumErrors() == 0) {
+        // The TAC doesn't point into the tree, so the tree (this node
+        // included) can go before the backend starts. Don't touch any
+        // members below. Lists the backend makes go on the heap.
+        Node::ReleaseTree();
         cg->DoFinalCodeGen();
+    }
+    delete cg;
 }
 
 StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
     (stmts=s)->SetParentAll(this);
+    nodeScope = NULL;
 }
-void StmtBlock::Check() {
-    nodeScope = new Scope();
+void StmtBlock::Bind(ScopeStack *scopes) {
+    nodeScope = OwnedByTree(new Scope());
     decls->DeclareAll(nodeScope);
+    scopes->Push(nodeScope);
+    decls->BindAll(scopes);
+    stmts->BindAll(scopes);
+    scopes->Pop();
+}
+void StmtBlock::Check() {
     decls->CheckAll();
     stmts->CheckAll();
 }
@@ -62,6 +96,10 @@ ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) {
     (body=b)->SetParent(this);
 }
 
+void ConditionalStmt::Bind(ScopeStack *scopes) {
+    test->Bind(scopes);
+    body->Bind(scopes);
+}
 void ConditionalStmt::Check() {
     if (!test->CheckAndComputeResultType()->IsCompatibleWith(Type::boolType))
 	ReportError::TestNotBoolean(test);
@@ -73,9 +111,19 @@ ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) {
     (init=i)->SetParent(this);
     (step=s)->SetParent(this);
 }
+void ForStmt::Bind(ScopeStack *scopes) {
+    init->Bind(scopes);
+    ConditionalStmt::Bind(scopes);
+    step->Bind(scopes);
+}
+void ForStmt::Check() {
+    init->Check();
+    ConditionalStmt::Check();
+    step->Check();
+}
 void ForStmt::Emit(CodeGenerator *cg) {
     init->Emit(cg);
-    char *topLoop = cg->NewLabel();
+    const char *topLoop = cg->NewLabel();
     afterLoopLabel = cg->NewLabel();
     cg->GenLabel(topLoop);
     test->Emit(cg);
@@ -86,7 +134,7 @@ void ForStmt::Emit(CodeGenerator *cg) {
     cg->GenLabel(afterLoopLabel);
 }
 void WhileStmt::Emit(CodeGenerator *cg) {
-    char *topLoop = cg->NewLabel();
+    const char *topLoop = cg->NewLabel();
     afterLoopLabel = cg->NewLabel();
     cg->GenLabel(topLoop);
     test->Emit(cg);
@@ -101,13 +149,17 @@ IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) {
     elseBody = eb;
     if (elseBody) elseBody->SetParent(this);
 }
+void IfStmt::Bind(ScopeStack *scopes) {
+    ConditionalStmt::Bind(scopes);
+    if (elseBody) elseBody->Bind(scopes);
+}
 void IfStmt::Check() {
     ConditionalStmt::Check();
     if (elseBody) elseBody->Check();
 }
 void IfStmt::Emit(CodeGenerator *cg) {
     test->Emit(cg);
-    char *afterElse, *elseL = cg->NewLabel();
+    const char *afterElse, *elseL = cg->NewLabel();
     cg->GenIfZ(test->result, elseL);
     body->Emit(cg);
     if (elseBody) {
@@ -135,6 +187,9 @@ ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) {
     Assert(e != NULL);
     (expr=e)->SetParent(this);
 }
+void ReturnStmt::Bind(ScopeStack *scopes) {
+    expr->Bind(scopes);
+}
 void ReturnStmt::Check() {
     Type *got = expr->CheckAndComputeResultType();
     Type *expected =  FindSpecificParent<FnDecl>()->GetReturnType();
@@ -150,6 +205,9 @@ PrintStmt::PrintStmt(List<Expr*> *a) {
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
 }
+void PrintStmt::Bind(ScopeStack *scopes) {
+    args->BindAll(scopes);
+}
 void PrintStmt::Check() {
     for (int i = 0; i < args->NumElements();i++) {
 	Type *t = args->Nth(i)->CheckAndComputeResultType();
@@ -161,7 +219,7 @@ void PrintStmt::Check() {
 void PrintStmt::Emit(CodeGenerator *cg) {
     for (int i = 0; i < args->NumElements(); i++) {
         Expr *arg = args->Nth(i);
-        Type *argType = arg->CheckAndComputeResultType();
+        Type *argType = arg->GetType();
 	  arg->Emit(cg);
         BuiltIn b = PrintInt;
         if (argType->IsEquivalentTo(Type::stringType))
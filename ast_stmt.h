@@ -21,9 +21,11 @@ class Program : public Node
 {
   protected:
      List<Decl*> *decls;
+     Scope *nodeScope;
      
   public:
      Program(List<Decl*> *declList);
+     Scope *PrepareScope();
      void Check();
      void Emit();
 };
@@ -40,9 +42,11 @@ class StmtBlock : public Stmt
   protected:
     List<VarDecl*> *decls;
     List<Stmt*> *stmts;
+    Scope *nodeScope;
     
   public:
     StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
+    void Bind(ScopeStack *scopes);
     void Check();
   
     void Emit(CodeGenerator *cg);
@@ -57,6 +61,7 @@ class ConditionalStmt : public Stmt
   
   public:
     ConditionalStmt(Expr *testExpr, Stmt *body);
+    void Bind(ScopeStack *scopes);
     void Check();
 };
 
@@ -77,6 +82,8 @@ class ForStmt : public LoopStmt
   
   public:
     ForStmt(Expr *init, Expr *test, Expr *step, Stmt *body);
+    void Bind(ScopeStack *scopes);
+    void Check();
     void Emit(CodeGenerator *cg);
 };
 
@@ -95,6 +102,7 @@ class IfStmt : public ConditionalStmt
   
   public:
     IfStmt(Expr *test, Stmt *thenBody, Stmt *elseBody);
+    void Bind(ScopeStack *scopes);
     void Check();
   
     void Emit(CodeGenerator *cg);
@@ -116,6 +124,7 @@ class ReturnStmt : public Stmt
   
   public:
     ReturnStmt(yyltype loc, Expr *expr);
+    void Bind(ScopeStack *scopes);
     void Check();
   
     void Emit(CodeGenerator *cg);
@@ -128,6 +137,7 @@ class PrintStmt : public Stmt
     
   public:
     PrintStmt(List<Expr*> *arguments);
+    void Bind(ScopeStack *scopes);
     void Check();
   
     void Emit(CodeGenerator *cg);
@@ -4,10 +4,13 @@
  */
 #include "ast_type.h"
 #include "ast_decl.h"
+#include <mutex>
 #include <string.h>
 
 #include "errors.h"
 #include "codegen.h"
+#include "intern.h"
+#include "scope.h"
  
 /* Class constants
  * ---------------
@@ -27,7 +30,27 @@ Type *Type::errorType  = new Type("error");
 
 Type::Type(const char *n) {
     Assert(n);
-    typeName = strdup(n);
+    typeName = Intern(n);
+    arrayOf = NULL;
+}
+
+/* Method: ArrayOf
+ * ---------------
+ * Made the first time it is asked for, then shared. It lives as long
+ * as its element type: for good for the built-ins, with the tree
+ * otherwise. Compilations on other threads may ask for the same
+ * built-in one at once, so those are made under a lock.
+ */
+static std::mutex builtInArrays;
+
+ArrayType *Type::ArrayOf() {
+    if (!IsBuiltIn()) {
+        if (!arrayOf) arrayOf = new ArrayType(this);
+        return arrayOf;
+    }
+    std::lock_guard<std::mutex> guard(builtInArrays);
+    if (!arrayOf) arrayOf = ::new ArrayType(this);
+    return arrayOf;
 }
 
  Type *Type::LesserType(Type *other) {
@@ -55,20 +78,26 @@ NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
     isError = false;
 } 
 
+void NamedType::Bind(ScopeStack *scopes) {
+    Decl *declForName = scopes->Lookup(id);
+    if (declForName && (declForName->IsClassDecl() || declForName->IsInterfaceDecl())) 
+        cachedDecl = declForName;
+}
+
+Type *NamedType::Canonical() {
+    if (ClassDecl *cd = dynamic_cast<ClassDecl*>(cachedDecl))
+        return cd->GetDeclaredType();
+    if (InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(cachedDecl))
+        return id->GetDeclaredType();
+    return this; // not a type, Check reports it
+}
+
 void NamedType::Check() {
     if (!GetDeclForType()) {
         isError = true;
         ReportError::IdentifierNotDeclared(id, LookingForType);
     }
 }
-Decl *NamedType::GetDeclForType() {
-    if (!cachedDecl && !isError) {
-        Decl *declForName = FindDecl(id);
-        if (declForName && (declForName->IsClassDecl() || declForName->IsInterfaceDecl())) 
-            cachedDecl = declForName;
-    }
-    return cachedDecl;
-}
 
 bool NamedType::IsInterface() {
     Decl *d = GetDeclForType();
@@ -82,7 +111,7 @@ bool NamedType::IsClass() {
 
 bool NamedType::IsEquivalentTo(Type *other) {
     NamedType *ot = dynamic_cast<NamedType*>(other);
-    return ot && strcmp(id->GetName(), ot->id->GetName()) == 0;
+    return ot && id->GetName() == ot->id->GetName(); // names are interned
 }
 bool NamedType::IsCompatibleWith(Type *other) {
     if (IsEquivalentTo(other)) return true;
@@ -100,11 +129,18 @@ ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
     (elemType=et)->SetParent(this);
 }
 
+// A canonical array type is not part of the tree: no location, and the
+// element keeps its own parent.
+ArrayType::ArrayType(Type *et) : Type() {
+    elemType = et;
+}
+
 void ArrayType::Check() {
     elemType->Check();
 }
 
 bool ArrayType::IsEquivalentTo(Type *other) {
+    if (this == other) return true;
     ArrayType *o = dynamic_cast<ArrayType*>(other);
     return (o && elemType->IsEquivalentTo(o->elemType));
 }
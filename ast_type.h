@@ -4,6 +4,12 @@
  * store type information. The base Type class is used
  * for built-in types, the NamedType for classes and interfaces,
  * and the ArrayType for arrays of other types.  
+ *
+ * Types are hash-consed: once names are bound, every type written in
+ * the program has a canonical Type (see Canonical) shared by all the
+ * types equivalent to it. Declarations and expressions only carry
+ * canonical types, so equivalent types in the checker are the same
+ * object and IsEquivalentTo is settled by the address.
  */
  
 #ifndef _H_ast_type
@@ -13,18 +19,26 @@
 #include "list.h"
 #include <iostream>
 
+class ArrayType;
 
 class Type : public Node 
 {
   protected:
-    char *typeName;
+    const char *typeName;
+    ArrayType *arrayOf;   // see ArrayOf
+
+    Type() : Node(), arrayOf(NULL) {}
 
   public :
     static Type *intType, *doubleType, *boolType, *voidType,
                 *nullType, *stringType, *errorType;
 
-    Type(yyltype loc) : Node(loc) {}
+    Type(yyltype loc) : Node(loc), arrayOf(NULL) {}
     Type(const char *str);
+
+          // The built-in types are shared by every tree (and every
+          // thread building one), so they are never given a parent
+    void SetParent(Node *p)  { if (GetLocation()) Node::SetParent(p); }
     
     virtual void PrintToStream(std::ostream& out) { out << typeName; }
     friend std::ostream& operator<<(std::ostream& out, Type *t) { t->PrintToStream(out); return out; }
@@ -35,6 +49,15 @@ class Type : public Node
     virtual bool IsNumeric() { return this == Type::intType || this == Type::doubleType; }
     virtual bool IsError() { return false;}
     virtual Type *LesserType(Type *other);
+
+          // The type standing for every type equivalent to this one: a
+          // built-in itself, the declared type of a class or interface,
+          // or the ArrayOf the canonical element type
+    virtual Type *Canonical() { return this; }
+          // The one array type with this canonical type as its elements
+    ArrayType *ArrayOf();
+          // Built-ins, and arrays of them, are shared by every tree
+    virtual bool IsBuiltIn() { return true; }
 	 
      void Emit(CodeGenerator *cg) {}  
 };
@@ -50,8 +73,11 @@ class NamedType : public Type
     NamedType(Identifier *i);
     
     void PrintToStream(std::ostream& out) { out << id; }
+    void Bind(ScopeStack *scopes);
     void Check();
-    Decl *GetDeclForType();
+    Type *Canonical();
+    bool IsBuiltIn() { return false; }
+    Decl *GetDeclForType() { return cachedDecl; } // found by Bind
     bool IsInterface();
     bool IsClass();
     Identifier *GetId() { return id; }
@@ -63,14 +89,21 @@ class NamedType : public Type
 
 class ArrayType : public Type 
 {
+  friend class Type;  // for ArrayOf
+
   protected:
     Type *elemType;
 
+    ArrayType(Type *elemType);
+
   public:
     ArrayType(yyltype loc, Type *elemType);
     
     void PrintToStream(std::ostream& out) { out << elemType << "[]"; }
+    void Bind(ScopeStack *scopes) { elemType->Bind(scopes); }
     void Check();
+    Type *Canonical() { return elemType->Canonical()->ArrayOf(); }
+    bool IsBuiltIn() { return elemType->IsBuiltIn(); }
     bool IsEquivalentTo(Type *other);
     bool IsArrayType() { return true; }
     Type *GetArrayElemType() { return elemType; }
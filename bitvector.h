@@ -0,0 +1,83 @@
+/* File: bitvector.h
+ * -----------------
+ * A set of small non-negative integers stored one bit each, packed
+ * into machine words so that union, difference and comparison work a
+ * word at a time. Used for data flow values once the variables of a
+ * function have been numbered densely (see liveness.h).
+ *
+ * Iterate over the members with Next:
+ *
+ *   for (int i = set.Next(0); i != -1; i = set.Next(i+1))
+ *       ...
+ */
+
+#ifndef _H_bitvector
+#define _H_bitvector
+
+#include <vector>
+#include "utility.h"  // for Assert()
+
+class BitVector
+{
+  public:
+    typedef unsigned long Word;
+    static const int BitsPerWord = 8 * sizeof(Word);
+
+    BitVector() {}
+    BitVector(int numBits) : words((numBits + BitsPerWord - 1) / BitsPerWord, 0) {}
+
+    bool Contains(int i) const
+      { Assert(i >= 0); return i / BitsPerWord < (int)words.size() &&
+               (words[i / BitsPerWord] >> (i % BitsPerWord)) & 1; }
+    void Insert(int i)
+      { Assert(i >= 0 && i / BitsPerWord < (int)words.size());
+        words[i / BitsPerWord] |= (Word)1 << (i % BitsPerWord); }
+    void Remove(int i)
+      { Assert(i >= 0 && i / BitsPerWord < (int)words.size());
+        words[i / BitsPerWord] &= ~((Word)1 << (i % BitsPerWord)); }
+
+          // Union and difference, in place
+    BitVector& operator|=(const BitVector& other);
+    BitVector& operator-=(const BitVector& other);
+
+    bool operator==(const BitVector& other) const { return words == other.words; }
+    bool operator!=(const BitVector& other) const { return words != other.words; }
+
+          // Returns the smallest member >= i, or -1 if there is none
+    int Next(int i) const;
+
+  private:
+    std::vector<Word> words;
+};
+
+
+inline BitVector& BitVector::operator|=(const BitVector& other)
+{
+    if (other.words.size() > words.size())
+        words.resize(other.words.size(), 0);
+    for (int w = 0; w < (int)other.words.size(); w++)
+        words[w] |= other.words[w];
+    return *this;
+}
+
+inline BitVector& BitVector::operator-=(const BitVector& other)
+{
+    int n = words.size() < other.words.size() ? words.size() : other.words.size();
+    for (int w = 0; w < n; w++)
+        words[w] &= ~other.words[w];
+    return *this;
+}
+
+inline int BitVector::Next(int i) const
+{
+    int w = i / BitsPerWord;
+    if (w >= (int)words.size()) return -1;
+    Word bits = words[w] & (~(Word)0 << (i % BitsPerWord));
+    while (!bits) {
+        if (++w == (int)words.size()) return -1;
+        bits = words[w];
+    }
+    return w * BitsPerWord + __builtin_ctzl(bits);
+}
+
+#endif
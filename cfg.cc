@@ -1,108 +1,144 @@
+#include <algorithm>
 #include "cfg.h"
 #include "tac.h"
+#include "codeunit.h"
+#include "utility.h"
 
 /*----------------------------------------------------------
  * Create and initialize new CFG
  */
-ControlFlowGraph::ControlFlowGraph(iterator first, iterator last)
-   : first( first ), last( last )
+ControlFlowGraph::ControlFlowGraph(CodeUnit& fn)
 {
-  //printf("-------------------- BEGIN BLOCK --------------------\n");
+  Assert(fn.IsFunction());
+  instrs.reserve(fn.NumInstructions());
+  for (CodeUnit::Position p= fn.First(); p != CodeUnit::End; p= fn.Next(p))
+    instrs.push_back(fn.At(p));
+  find_blocks();
   map_labels();
   map_edges();
-  //printf("--------------------- END BLOCK ---------------------\n");
 }
 
 /*----------------------------------------------------------
- * Build map from labels -> instructions
+ * Split the instructions into maximal basic blocks. A block starts
+ * at the first instruction, at every label, after every branch or
+ * return, and at EndFunc (so a return has a block to go to). Calls
+ * return to the following instruction, so they do not end a block.
  */
-void ControlFlowGraph::map_labels()
+void ControlFlowGraph::find_blocks()
 {
-  for (iterator p= first; p != last; ++p)
+  int n= instrs.size();
+  std::vector<bool> leader(n, false);
+  leader[0]= leader[n-1]= true;
+  for (int i= 0; i < n; i++)
   {
-    Label* label= dynamic_cast<Label*>(*p);
-    if (label) {
-      instr_for_label[label->text()]= *p;
+    switch (instrs[i]->GetOpcode()) {
+      case Instruction::TacLabel:
+        leader[i]= true;
+        break;
+      case Instruction::TacGoto:
+      case Instruction::TacIfZ:
+      case Instruction::TacReturn:
+        if (i+1 < n)
+          leader[i+1]= true;
+        break;
+      default:
+        break;
     }
   }
+
+  block_of.resize(n);
+  for (int i= 0; i < n; i++)
+  {
+    if (leader[i])
+      block_start.push_back(i);
+    block_of[i]= block_start.size() - 1;
+  }
+  block_start.push_back(n);
 }
 
 /*----------------------------------------------------------
- * Build map from instruction -> input edges
- * Build map from instruction -> output edges
+ * Build the table from label -> block it starts. Labels are
+ * interned, so the table is ordered and searched by address.
  */
-void ControlFlowGraph::map_edges()
+static bool LabelLess(const std::pair<const char*, int>& a,
+                      const std::pair<const char*, int>& b)
 {
-  std::string jumpType;
-  for (iterator cur= first; cur != last; ++cur)
-  {
-    iterator next= cur;
-    ++next;
+  return a.first < b.first;
+}
 
-    //add_edge(*cur, *next); 
-    if (dynamic_cast<Return*>(*cur)) {
-        next = first;
-        add_edge(*cur, *next); 
-    }
-    else if (dynamic_cast<LCall*>(*cur)) {
-        jumpType = "LCall";
-        map_edges_for_jump(cur, jumpType);
-    }
-    else if (dynamic_cast<ACall*>(*cur)) {
-        jumpType = "ACall";
-        map_edges_for_jump(cur, jumpType);
-    }
-    else if (dynamic_cast<IfZ*>(*cur)) {
-        jumpType = "IfZ";
-        map_edges_for_jump(cur, jumpType);
-    }
-    else if (dynamic_cast<Goto*>(*cur)) {
-        jumpType = "Goto";
-        map_edges_for_jump(cur, jumpType);
-    }
+void ControlFlowGraph::map_labels()
+{
+  for (int b= 0; b < num_blocks(); b++)
+  {
+    Instruction* first= instrs[block_begin(b)];
+    if (first->GetOpcode() == Instruction::TacLabel)
+      labels.push_back(std::make_pair(static_cast<Label*>(first)->text(), b));
   }
+  std::sort(labels.begin(), labels.end(), LabelLess);
 }
 
-void ControlFlowGraph::map_edges_for_jump(iterator cur, std::string jumpType)
+int ControlFlowGraph::block_for_label(const char* label) const
 {
-    int jumpInstrLength = jumpType.length() + 1;
-    std::string label_string_to_find = (*cur)->getPrinted();
-    size_t pos_to_remove_from = label_string_to_find.find(jumpType);
-    label_string_to_find.erase(0, pos_to_remove_from + jumpInstrLength);
-    Instruction* label_instr;
-
-    // if label is in this block
-    if (instr_for_label.find(label_string_to_find) != instr_for_label.end()) {
-        label_instr = instr_for_label.at(label_string_to_find);
-        add_edge(*cur, label_instr);
-    }
-    else {
-        //label is in another block, come back to it. 
-        if (strcmp(label_string_to_find.c_str(), "_PrintString") == 0 || 
-                strcmp(label_string_to_find.c_str(), "_PrintInt") == 0) {
-            // PrintString, PrintInt todo.
-            // (jump to their offset relative to the end of the file?
-            //    that code is always the same...)
-            return;
-        }
-        //printf("%s is in another block.\n", label_string_to_find.c_str());
-        add_edge(*cur, *cur);
-    }
+  // branches never leave the function, the label must be in here
+  std::pair<const char*, int> key(label, 0);
+  std::vector< std::pair<const char*, int> >::const_iterator found=
+    std::lower_bound(labels.begin(), labels.end(), key, LabelLess);
+  Assert(found != labels.end() && found->first == label);
+  return found->second;
 }
 
 /*----------------------------------------------------------
- * Add edge going between two instructions
+ * Build the successor and predecessor rows of every block.
+ * Each block falls through to the next one except when it ends
+ * in an unconditional Goto (target only) or a Return (which
+ * leaves through the EndFunc block).
  */
-void ControlFlowGraph::add_edge(Instruction* from, Instruction* to)
+void ControlFlowGraph::map_edges()
 {
-    /*
-  printf("BEGIN EDGE\n");
-  printf("    from: ");
-  from->Print();
-  printf("    to:    ");
-  to->Print();
-  printf("END EDGE\n\n");
-  */
-  in_edges[to].push_back(from);
-  out_edges[from].push_back(to);
+  int nblocks= num_blocks();
+  std::vector< std::pair<int, int> > edges; // (from, to), grouped by from
+
+  succ_start.resize(nblocks + 1);
+  for (int b= 0; b < nblocks; b++)
+  {
+    succ_start[b]= edges.size();
+    Instruction* end= instrs[block_end(b) - 1];
+    int target= -1, next= (b+1 < nblocks) ? b+1 : -1;
+
+    switch (end->GetOpcode()) {
+      case Instruction::TacReturn:
+        target= nblocks - 1;
+        next= -1;
+        break;
+      case Instruction::TacGoto:
+        target= block_for_label(end->GetBranchTarget());
+        next= -1;
+        break;
+      case Instruction::TacIfZ:
+        target= block_for_label(end->GetBranchTarget());
+        break;
+      default:
+        break;
+    }
+
+    if (target != -1)
+      edges.push_back(std::make_pair(b, target));
+    if (next != -1 && next != target)
+      edges.push_back(std::make_pair(b, next));
+  }
+  succ_start[nblocks]= edges.size();
+
+  succ.resize(edges.size());
+  pred.resize(edges.size());
+  pred_start.assign(nblocks + 1, 0);
+  for (int e= 0; e < (int)edges.size(); e++)
+  {
+    succ[e]= edges[e].second;
+    pred_start[edges[e].second + 1]++;
+  }
+  for (int b= 0; b < nblocks; b++)
+    pred_start[b+1]+= pred_start[b];
+  std::vector<int> fill(pred_start.begin(), pred_start.end() - 1);
+  for (int e= 0; e < (int)edges.size(); e++)
+    pred[fill[edges[e].second]++]= edges[e].first;
 }
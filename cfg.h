@@ -1,52 +1,64 @@
 #ifndef _H_CFG
 #define _H_CFG
 
-#include <list>
-#include <map>
-#include <string>
-#include <iostream>
 #include <vector>
 
 class Instruction;
-typedef std::vector<Instruction*> EdgeList;
-typedef std::list<Instruction*> Block;
+class CodeUnit;
 
 /*==========================================================
  * ControlFlowGraph
  * ----------------
- * Represents control flow graph for a single function.
- * Assumes we're creating a CFG based on list<Instruction*>
- * found in CodeGen class.
- * Creates a map of edges between individual instructions.
- * Accessed using a flow class.
+ * Represents control flow graph for a single function, built from
+ * the function's CodeUnit in CodeGen class.
+ * The instructions are numbered 0..num_instrs()-1 in list order and
+ * split into maximal basic blocks, numbered 0..num_blocks()-1 in the
+ * same order. Block b holds instructions block_begin(b) up to (not
+ * including) block_end(b). Successor and predecessor lists are kept
+ * as compressed sparse rows: one flat array of block numbers plus an
+ * offset per block. Accessed using a flow class.
  */
 class ControlFlowGraph
 {
 public:
-  // based on CodeGen implementation of list-of-instruction-pointers
-  typedef std::list<Instruction*>::iterator iterator;
-
-  // Constructor - provide iterator to BeginFunc and EndFunc
-  ControlFlowGraph(iterator first, iterator last);
-  void add_block(Block);
+  // Constructor - provide the unit holding BeginFunc through EndFunc
+  ControlFlowGraph(CodeUnit& fn);
+
+  // Instructions, in list order
+  int num_instrs() const { return instrs.size(); }
+  Instruction* instr(int i) const { return instrs[i]; }
+
+  // Basic blocks and their edges
+  int num_blocks() const { return block_start.size() - 1; }
+  int block_begin(int b) const { return block_start[b]; }
+  int block_end(int b) const { return block_start[b+1]; }
+  int block_containing(int i) const { return block_of[i]; }
+  const int* succ_begin(int b) const { return row(succ, succ_start[b]); }
+  const int* succ_end(int b) const { return row(succ, succ_start[b+1]); }
+  const int* pred_begin(int b) const { return row(pred, pred_start[b]); }
+  const int* pred_end(int b) const { return row(pred, pred_start[b+1]); }
 
   // Flow classes (below)
   class ForwardFlow;
   class ReverseFlow;
 
 private:
+  void find_blocks();
   void map_labels();
   void map_edges();
-  void add_edge(Instruction* from, Instruction* to);
-  void map_edges_for_jump(iterator cur, std::string jumpType);
+  int block_for_label(const char* label) const;
+  static const int* row(const std::vector<int>& v, int offset)
+    { return v.empty() ? NULL : &v[0] + offset; }
 
-  iterator first;
-  iterator last;
-  std::map<std::string, Instruction*> instr_for_label;
-  std::map<Instruction*, EdgeList> in_edges;
-  std::map<Instruction*, EdgeList> out_edges;
+  std::vector<Instruction*> instrs;
+  std::vector<int> block_start;  // first instruction per block, plus end
+  std::vector<int> block_of;     // block per instruction
 
+  // label -> block it starts, sorted by (interned) label address
+  std::vector< std::pair<const char*, int> > labels;
 
+  std::vector<int> succ_start, succ;
+  std::vector<int> pred_start, pred;
 };
 
 /*==========================================================
@@ -58,19 +70,31 @@ class ControlFlowGraph::ForwardFlow
 {
 public:
   // iterator type
-  typedef std::list<Instruction*>::const_iterator iterator;
+  typedef std::vector<Instruction*>::const_iterator iterator;
 
   // Constructor - specify the CFG to walk over
   ForwardFlow( ControlFlowGraph& cfg ) : cfg( cfg )
   { }
 
   // First and last instruction (inclusive)
-  iterator first() { return iterator( cfg.first ); }
-  iterator last()  { return iterator( cfg.last );  }
+  iterator first() { return cfg.instrs.begin(); }
+  iterator last()  { return cfg.instrs.end() - 1; }
+
+  // Blocks, the entry block and the edges in forward direction
+  int num_blocks() { return cfg.num_blocks(); }
+  int entry() { return 0; }
+  const int* in_begin(int b)  { return cfg.pred_begin(b); }
+  const int* in_end(int b)    { return cfg.pred_end(b); }
+  const int* out_begin(int b) { return cfg.succ_begin(b); }
+  const int* out_end(int b)   { return cfg.succ_end(b); }
+
+  // Instructions of a block in forward order: from block_first(b),
+  // moving by step(), through block_last(b) (instruction numbers)
+  int block_first(int b) { return cfg.block_begin(b); }
+  int block_last(int b)  { return cfg.block_end(b) - 1; }
+  int step() { return 1; }
 
-  // Edges in forward direction
-  std::map<Instruction*, EdgeList>& in() { return cfg.in_edges; }
-  std::map<Instruction*, EdgeList>& out() { return cfg.out_edges; }
+  ControlFlowGraph& graph() { return cfg; }
 
 private:
   ControlFlowGraph& cfg;
@@ -79,25 +103,37 @@ private:
 /*==========================================================
  * ControlFlowGraph::ReverseFlow
  * -----------------------------
- * Used to walk over a CFG in a forward direction.
+ * Used to walk over a CFG in a reverse direction.
  */
 class ControlFlowGraph::ReverseFlow
 {
 public:
   // iterator type
-  typedef std::list<Instruction*>::const_reverse_iterator iterator;
+  typedef std::vector<Instruction*>::const_reverse_iterator iterator;
 
   // Constructor - specify the CFG to walk over
   ReverseFlow( ControlFlowGraph& cfg ) : cfg( cfg )
   { }
 
   // First and last instruction (inclusive)
-  iterator first() { return iterator( cfg.last );  }
-  iterator last()  { return iterator( cfg.first ); }
-
-  // Edges in reverse direction
-  std::map<Instruction*, EdgeList>& in() { return cfg.out_edges; }
-  std::map<Instruction*, EdgeList>& out() { return cfg.in_edges; }
+  iterator first() { return cfg.instrs.rbegin(); }
+  iterator last()  { return cfg.instrs.rend() - 1; }
+
+  // Blocks, the entry block (the one ending the function) and the
+  // edges in reverse direction
+  int num_blocks() { return cfg.num_blocks(); }
+  int entry() { return cfg.num_blocks() - 1; }
+  const int* in_begin(int b)  { return cfg.succ_begin(b); }
+  const int* in_end(int b)    { return cfg.succ_end(b); }
+  const int* out_begin(int b) { return cfg.pred_begin(b); }
+  const int* out_end(int b)   { return cfg.pred_end(b); }
+
+  // Instructions of a block in reverse order
+  int block_first(int b) { return cfg.block_end(b) - 1; }
+  int block_last(int b)  { return cfg.block_begin(b); }
+  int step() { return -1; }
+
+  ControlFlowGraph& graph() { return cfg; }
 
 private:
   ControlFlowGraph& cfg;
@@ -2,36 +2,60 @@
  * ----------------
  * Implementation for the CodeGenerator class. The methods don't do anything
  * too fancy, mostly just create objects of the various Tac instruction
- * classes and append them to the list.
+ * classes and append them to the current code unit.
  */
 
 #include "codegen.h"
 #include <string.h>
 #include "tac.h"
 #include "mips.h"
+#include "regalloc.h"
+#include "liveness.h"
 #include "ast_decl.h"
 #include "errors.h"
+#include "intern.h"
+#include "compilation.h"
+#include "timing.h"
 
-Location* CodeGenerator::ThisPtr= new Location(fpRelative, 4, "this");
+Location* CodeGenerator::ThisPtr= new Location(fpRelative, 4, Intern("this"));
 
 CodeGenerator::CodeGenerator()
 {
     curGlobalOffset = 0;
+    current = NULL;
+    nextLabelNum = nextTempNum = 0;
 }
 
-char *CodeGenerator::NewLabel()
+CodeGenerator::~CodeGenerator()
 {
-    static int nextLabelNum = 0;
-    char temp[10];
+    for (int i = 0; i < code.size(); i++)
+        delete code[i];  // those DoFinalCodeGen didn't get to
+}
+
+Arena& CodeGenerator::Pool()
+{
+    if (!current) // between functions
+        code.push_back(current = new CodeUnit(false));
+    return *current->GetArena();
+}
+
+void CodeGenerator::Append(Instruction *instr)
+{
+    Assert(current != NULL); // instr was made in Pool()
+    current->Append(instr);
+}
+
+const char *CodeGenerator::NewLabel()
+{
+    char temp[16];   // room for any int
     sprintf(temp, "_L%d", nextLabelNum++);
-    return strdup(temp);
+    return Intern(temp);
 }
 
 
 Location *CodeGenerator::GenTempVar()
 {
-    static int nextTempNum;
-    char temp[10];
+    char temp[16];   // room for any int
     Location *result = NULL;
     sprintf(temp, "_tmp%d", nextTempNum++);
     return GenLocalVariable(temp);
@@ -41,54 +65,62 @@ Location *CodeGenerator::GenTempVar()
 Location *CodeGenerator::GenLocalVariable(const char *varName)
 {
     curStackOffset -= VarSize;
-    return new Location(fpRelative, curStackOffset+4,  varName);
+    return new (Pool()) Location(fpRelative, curStackOffset+4, Intern(varName));
 }
 
 Location *CodeGenerator::GenGlobalVariable(const char *varName)
 {
     curGlobalOffset += VarSize;
-    return new Location(gpRelative, curGlobalOffset -4, varName);
+    return new (globals) Location(gpRelative, curGlobalOffset -4, Intern(varName));
+}
+
+Location *CodeGenerator::GenReference(Location *base, int refOffset)
+{
+    return new (Pool()) Location(base, refOffset);
 }
 
 
 Location *CodeGenerator::GenLoadConstant(int value)
 {
     Location *result = GenTempVar();
-    code.push_back(new LoadConstant(result, value));
+    Append(new (Pool()) LoadConstant(result, value));
     return result;
 }
 
 Location *CodeGenerator::GenLoadConstant(const char *s)
 {
     Location *result = GenTempVar();
-    code.push_back(new LoadStringConstant(result, s));
+    const char *quote = (*s == '"') ? "" : "\"";
+    char *str = (char *)Pool().Allocate(strlen(s) + 2*strlen(quote) + 1);
+    sprintf(str, "%s%s%s", quote, s, quote);
+    Append(new (Pool()) LoadStringConstant(result, str));
     return result;
 }
 
 Location *CodeGenerator::GenLoadLabel(const char *label)
 {
     Location *result = GenTempVar();
-    code.push_back(new LoadLabel(result, label));
+    Append(new (Pool()) LoadLabel(result, Intern(label)));
     return result;
 }
 
 
 void CodeGenerator::GenAssign(Location *dst, Location *src)
 {
-    code.push_back(new Assign(dst, src));
+    Append(new (Pool()) Assign(dst, src));
 }
 
 
 Location *CodeGenerator::GenLoad(Location *ref, int offset)
 {
     Location *result = GenTempVar();
-    code.push_back(new Load(result, ref, offset));
+    Append(new (Pool()) Load(result, ref, offset));
     return result;
 }
 
 void CodeGenerator::GenStore(Location *dst,Location *src, int offset)
 {
-    code.push_back(new Store(dst, src, offset));
+    Append(new (Pool()) Store(dst, src, offset));
 }
 
 
@@ -96,68 +128,72 @@ Location *CodeGenerator::GenBinaryOp(const char *opName, Location *op1,
                                      Location *op2)
 {
     Location *result = GenTempVar();
-    code.push_back(new BinaryOp(BinaryOp::OpCodeForName(opName), result, op1, op2));
+    Append(new (Pool()) BinaryOp(BinaryOp::OpCodeForName(opName), result, op1, op2));
     return result;
 }
 
 
 void CodeGenerator::GenLabel(const char *label)
 {
-    code.push_back(new Label(label));
+    Append(new (Pool()) Label(Intern(label)));
 }
 
 void CodeGenerator::GenIfZ(Location *test, const char *label)
 {
-    code.push_back(new IfZ(test, label));
+    Append(new (Pool()) IfZ(test, Intern(label)));
 }
 
 void CodeGenerator::GenGoto(const char *label)
 {
-    code.push_back(new Goto(label));
+    Append(new (Pool()) Goto(Intern(label)));
 }
 
 void CodeGenerator::GenReturn(Location *val)
 {
-    code.push_back(new Return(val));
+    Append(new (Pool()) Return(val));
 }
 
 
 BeginFunc *CodeGenerator::GenBeginFunc(FnDecl *fn)
 {
-    BeginFunc *result = new BeginFunc;
-    code.push_back(insideFn = result);
+    code.push_back(current = new CodeUnit(true));
+    current->SetName(fn->GetFunctionLabel());
+    BeginFunc *result = new (Pool()) BeginFunc;
+    Append(insideFn = result);
     List<VarDecl*> *formals = fn->GetFormals();
     int start = OffsetToFirstParam;
     if (fn->IsMethodDecl()) start += VarSize;
     for (int i = 0; i < formals->NumElements(); i++)
-        formals->Nth(i)->rtLoc = new Location(fpRelative, i*VarSize + start, formals->Nth(i)->GetName());
+        formals->Nth(i)->rtLoc = new (Pool()) Location(fpRelative, i*VarSize + start,
+                                                       Intern(formals->Nth(i)->GetName()));
     curStackOffset = OffsetToFirstLocal;
     return result;
 }
 
 void CodeGenerator::GenEndFunc()
 {
-    code.push_back(new EndFunc());
+    Append(new (Pool()) EndFunc());
     insideFn->SetFrameSize(OffsetToFirstLocal-curStackOffset);
     insideFn = NULL;
+    current = NULL;
 }
 
 void CodeGenerator::GenPushParam(Location *param)
 {
-    code.push_back(new PushParam(param));
+    Append(new (Pool()) PushParam(param));
 }
 
 void CodeGenerator::GenPopParams(int numBytesOfParams)
 {
     Assert(numBytesOfParams >= 0 && numBytesOfParams % VarSize == 0); // sanity check
     if (numBytesOfParams > 0)
-        code.push_back(new PopParams(numBytesOfParams));
+        Append(new (Pool()) PopParams(numBytesOfParams));
 }
 
 Location *CodeGenerator::GenLCall(const char *label, bool fnHasReturnValue)
 {
     Location *result = fnHasReturnValue ? GenTempVar() : NULL;
-    code.push_back(new LCall(label, result));
+    Append(new (Pool()) LCall(Intern(label), result));
     return result;
 }
 
@@ -173,7 +209,7 @@ Location *CodeGenerator::GenFunctionCall(const char *fnLabel, List<Location*> *a
 Location *CodeGenerator::GenACall(Location *fnAddr, bool fnHasReturnValue)
 {
     Location *result = fnHasReturnValue ? GenTempVar() : NULL;
-    code.push_back(new ACall(fnAddr, result));
+    Append(new (Pool()) ACall(fnAddr, result));
     return result;
 }
 
@@ -215,9 +251,9 @@ Location *CodeGenerator::GenBuiltInCall(BuiltIn bn,Location *arg1, Location *arg
     Assert((b->numArgs == 0 && !arg1 && !arg2)
            || (b->numArgs == 1 && arg1 && !arg2)
            || (b->numArgs == 2 && arg1 && arg2));
-    if (arg2) code.push_back(new PushParam(arg2));
-    if (arg1) code.push_back(new PushParam(arg1));
-    code.push_back(new LCall(b->label, result));
+    if (arg2) Append(new (Pool()) PushParam(arg2));
+    if (arg1) Append(new (Pool()) PushParam(arg1));
+    Append(new (Pool()) LCall(Intern(b->label), result));
     GenPopParams(VarSize*b->numArgs);
     return result;
 }
@@ -225,224 +261,163 @@ Location *CodeGenerator::GenBuiltInCall(BuiltIn bn,Location *arg1, Location *arg
 
 void CodeGenerator::GenVTable(const char *className, List<const char *> *methodLabels)
 {
-    code.push_back(new VTable(className, methodLabels));
+    int n = methodLabels->NumElements();
+    const char **labels = (const char **)Pool().Allocate(n * sizeof(const char *));
+    for (int i = 0; i < n; i++)
+        labels[i] = Intern(methodLabels->Nth(i));
+    Append(new (Pool()) VTable(Intern(className), labels, n));
 }
 
 
 void CodeGenerator::DoFinalCodeGen()
 {
     if (IsDebugOn("tac")) { // if debug don't translate to mips, just print Tac
-        std::list<Instruction*>::iterator p;
-        for (p= code.begin(); p != code.end(); ++p) {
-            (*p)->Print();
-        }
+        for (int i = 0; i < code.size(); i++)
+            for (CodeUnit::Position p = code[i]->First(); p != CodeUnit::End; p = code[i]->Next(p))
+                code[i]->At(p)->Print();
         return;
     }  
-    Mips mips;
-    mips.EmitPreamble();
-
-    std::list<Instruction*>::iterator p= code.begin(),
-                                      begin_block= code.end(),
-                                      end_block= code.end();
-
-    int block_count = 0;
-    Block current_block;
-    std::list<ControlFlowGraph> cfg_list;
-    std::list<ControlFlowGraph>::iterator cfg_list_iter;
-    while (p != code.end())
-    {
-        // Watch for beginning of function
-        if (dynamic_cast<BeginFunc*>(*p))
-        {
-            //begin_block = --p;
-            begin_block = p;
-            current_block.push_back((*begin_block));
-            //current_block.push_back((*p));
-
-            /*
-            do ++p;
-            while (p != code.end() && !dynamic_cast<EndFunc*>(*p));
-            */
-            while (p != code.end()) 
-            {
-                if (dynamic_cast<EndFunc*>(*p)) {
-                    break;
-                }
-                ++p;
-            }
-            if (p == code.end())
-                p= begin_block;
-            else
-            {
-                end_block= p;
-                current_block.push_back((*end_block)); 
-                Block::iterator b_iter = current_block.begin();
-                /*
-                for (p= begin_block; p != end_block; ++p) {
-                    (*p)->Print();
-                }
-                */
-
-                ControlFlowGraph cfg(begin_block, end_block);
-                cfg_list.push_back(cfg);
-                current_block.clear();
-                block_count++;
-
-                //ControlFlowGraph cfg(begin_block, end_block);
-                // TODO (phase 2): use CFG for liveness analysis
-
-                // Now go back and print out the instructions
-                for (p= begin_block; p != end_block; ++p) {
-                    //(*p)->Emit(&mips);
-                    //(*p)->Print();
-                }
-            }
-        }
-
-        //(*p)->Emit(&mips);
-        //(*p)->Print();
-        current_block.push_back((*p));
-        ++p;
+    std::ostream& out = Compilation::Current()->Output();
+    Mips preamble;
+    preamble.EmitPreamble();
+    std::string text;
+    preamble.TakeText(&text);
+    out << text;
+
+    const std::string& cacheDir = Compilation::Current()->Options().cacheDir;
+    UnitCache *cache = cacheDir.empty() ? NULL : new UnitCache(cacheDir);
+    UnitTranslation translation(this, cache);
+    // debug printing goes to the output too, so it is kept on one thread
+    bool debugging = !Compilation::Current()->Options().debugKeys.empty();
+    RunTasks(&translation, code.size(), debugging ? 1 : NumThreads());
+    if (cache) {
+        Compilation::Current()->CountCacheLookups(cache->NumHits(), cache->NumMisses());
+        delete cache;
     }
+    globals.Release();
+}
 
-    //printf("Size of cfg_list: %d\n", cfg_list.size());
-
-    std::list<std::map<Location*, Instruction*> > liveness_list;
-    std::list<std::map<Location*, Instruction*> >::iterator liveness_list_iter;
-
-    std::map<Location*, Instruction*> variable_list;
-    std::map<Location*, Instruction*>::iterator variable_list_iter;
-    for (cfg_list_iter = cfg_list.begin(); cfg_list_iter != cfg_list.end(); cfg_list_iter++) {
-        //printf("NEW FUNCTION\n");
-        variable_list.clear(); // clear for each cfg.
-        ControlFlowGraph::ForwardFlow flow((*cfg_list_iter));
-        ControlFlowGraph::ForwardFlow::iterator cfg_iter = flow.first();
-        /*
-        ControlFlowGraph::ReverseFlow flow((*cfg_list_iter));
-        ControlFlowGraph::ReverseFlow::iterator cfg_iter = flow.first();
-        */
-        for (cfg_iter; cfg_iter != flow.last(); cfg_iter++) {
-            //(*cfg_iter)->Print();
-            //(*cfg_iter)->Emit(&mips);
-            int numVars = (*cfg_iter)->numVars;
-            if(numVars == 1 || numVars == 2 || numVars == 3) {
-                variable_list_iter = variable_list.find((*cfg_iter)->varA);
-                if (variable_list_iter == variable_list.end()) {
-                }
-                else {
-                    variable_list.erase(variable_list_iter);
-                }
-                if (strstr((*cfg_iter)->varA->GetName(), "_tmp") != NULL) {
-                    variable_list.insert(std::pair<Location*, Instruction*>((*cfg_iter)->varA,(*cfg_iter)));
-                }
-            }
-            if(numVars == 2 || numVars == 3) {
-                variable_list_iter = variable_list.find((*cfg_iter)->varB);
-                if (variable_list_iter == variable_list.end()) {
-                }
-                else {
-                    variable_list.erase(variable_list_iter);
-                }
-                if (strstr((*cfg_iter)->varB->GetName(), "_tmp") != NULL) {
-                    variable_list.insert(std::pair<Location*, Instruction*>((*cfg_iter)->varB,(*cfg_iter)));
-                }
-            }
-            if(numVars == 3) {
-                variable_list_iter = variable_list.find((*cfg_iter)->varC);
-                if (variable_list_iter == variable_list.end()) {
-                }
-                else {
-                    variable_list.erase(variable_list_iter);
-                }
-                if (strstr((*cfg_iter)->varC->GetName(), "_tmp") != NULL) {
-                    variable_list.insert(std::pair<Location*, Instruction*>((*cfg_iter)->varC,(*cfg_iter)));
-                }
-            }
-            /*
-            if (flow.in().find((*cfg_iter)) != flow.in().end()) {
-                printf("  To: ");
-                ((flow.in().find((*cfg_iter)))->first)->Print();
-            }
-            if (flow.out().find((*cfg_iter)) != flow.out().end()) {
-                printf("From: ");
-                ((flow.out().find((*cfg_iter)))->first)->Print();
-            }
-            */
-        }
-        liveness_list.push_back(variable_list);
-        for (variable_list_iter = variable_list.begin(); variable_list_iter != variable_list.end(); variable_list_iter++) {
-            /*
-            Instruction* discard_instr = new DiscardValue(variable_list_iter->first);
-            discard_instr->EmitSpecific(&mips);
-            */
-            /*
-            // print last use of variable *in this function*
-            printf("Last use of variable %s: ", variable_list_iter->first->GetName());
-            (variable_list_iter->second)->Print();
-            */
-        }
+
+/* Class: UnitTranslation
+ * ----------------------
+ * The batch of tasks DoFinalCodeGen runs: task i translates code unit i
+ * into text of its own, and the texts are written out in unit order,
+ * so the output is the same however many threads do the work. The
+ * string constants are numbered up front, in program order, so each
+ * unit knows where its numbering starts.
+ */
+CodeGenerator::UnitTranslation::UnitTranslation(CodeGenerator *cg, UnitCache *cache)
+  : compilation(Compilation::Current()), cg(cg), cache(cache),
+    firstString(cg->code.size()), text(cg->code.size())
+{
+    for (int i = 0, next = 1; i < cg->code.size(); i++) {
+        firstString[i] = next;
+        CodeUnit *unit = cg->code[i];
+        for (CodeUnit::Position p = unit->First(); p != CodeUnit::End; p = unit->Next(p))
+            if (unit->At(p)->GetOpcode() == Instruction::TacLoadStringConstant)
+                next++;
     }
+}
 
-    /*
-    if (block_count != liveness_list.size()) {
-        printf("Number of blocks: %d, Number of liveness data sets: %d\n", block_count, liveness_list.size());
+void CodeGenerator::UnitTranslation::Do(int i)
+{
+    Compilation::SetCurrent(compilation);
+    CodeUnit *unit = cg->code[i];
+    PhaseTimer timer(EmitPhase, unit->GetName());  // less the phases below it
+    UnitCache::Key key;
+    bool cached = cache && cache->MakeKey(unit, firstString[i], &key);
+    if (cached && cache->Find(key, &text[i])) {
+        delete unit;
+        cg->code[i] = NULL;
         return;
     }
-    */
-
-    block_count = 0;
-    p = code.begin();
-    while (p != code.end())
-    {
-        // Watch for beginning of function
-        if (dynamic_cast<BeginFunc*>(*p))
-        {
-            begin_block = p;
-            while (p != code.end()) 
-            {
-                if (dynamic_cast<EndFunc*>(*p)) {
-                    break;
-                }
-                ++p;
-            }
-            if (p == code.end())
-                p= begin_block;
-            else
-            {
-                end_block= p;
-                block_count++;
-                if (block_count == 1) {
-                    liveness_list_iter = liveness_list.begin();
-                }
-                else {
-                    liveness_list_iter++;
-                }
-                for (p= begin_block; p != end_block; ++p) {
-                    (*p)->Emit(&mips);
-                    for (variable_list_iter = (*liveness_list_iter).begin(); variable_list_iter != (*liveness_list_iter).end(); variable_list_iter++) {
-                        if ((*p) == (*variable_list_iter).second) {
-                            Instruction* discard_instr = new DiscardValue(variable_list_iter->first);
-                            discard_instr->EmitSpecific(&mips);
-                            /*
-                            (*p)->Print();
-                            (*variable_list_iter).second->Print();
-                            */
-                        }
-                        /*
-                        if (&(*variable_list_iter) == (*p)) {
-                            (*p)->Emit(&mips);
-                        }
-                        */
-                    }
-                }
-            }
+
+    Mips mips(firstString[i]);
+    if (!unit->IsFunction()) {
+        for (CodeUnit::Position p = unit->First(); p != CodeUnit::End; p = unit->Next(p))
+            unit->At(p)->Emit(&mips);
+    } else if (OptimizationLevel() >= 1) {
+        cg->EmitWithRegisterAllocator(&mips, unit);
+    } else {
+        cg->EmitWithLiveness(&mips, unit);
+    }
+    mips.TakeText(&text[i]);
+    if (cached) cache->Save(key, text[i]);
+    delete unit;  // nothing later points into its arena
+    cg->code[i] = NULL;
+}
+
+void CodeGenerator::UnitTranslation::Finish(int i)
+{
+    Compilation::Current()->Output() << text[i];
+    std::string().swap(text[i]);
+}
+
+
+/* Method: EmitWithLiveness
+ * ------------------------
+ * Translates one function to MIPS, letting Mips pick registers as it
+ * goes. After each instruction, Mips is told which of the locals/temps
+ * the instruction touched are now dead (on every path, per liveness
+ * analysis), so their registers can be reused without spilling.
+ * Globals are left alone since other functions may read them.
+ */
+void CodeGenerator::EmitWithLiveness(Mips *mips, CodeUnit *fn)
+{
+    BeginPhase(CfgPhase);
+    ControlFlowGraph cfg(*fn);
+    EndPhase(CfgPhase);
+    BeginPhase(DataflowPhase);
+    Liveness live(cfg);
+    EndPhase(DataflowPhase);
+    for (int i = 0; i < cfg.num_instrs(); i++) {
+        Instruction *instr = cfg.instr(i);
+        instr->Emit(mips);
+        if (instr->GetOpcode() == Instruction::TacEndFunc)
+            break;
+
+        Location *vars[3];
+        int n = instr->GetUses(vars);
+        if (instr->GetDef())
+            vars[n++] = instr->GetDef();
+        const LiveSet& out = live.LiveOut(i);
+        for (int v = 0; v < n; v++) {
+            bool seen = false;
+            for (int w = 0; w < v; w++)
+                if (vars[w] == vars[v]) seen = true;
+            if (!seen && vars[v]->GetSegment() == fpRelative &&
+                !out.Contains(live.IndexOf(vars[v])))
+                mips->EmitDiscardValue(vars[v]);
         }
-        (*p)->Emit(&mips);
-        ++p;
     }
 }
 
 
+/* Method: EmitWithRegisterAllocator
+ * ----------------------------------
+ * Translates one function to MIPS, allocating registers for it as a
+ * whole before emitting its body: linear scan at -O1, graph coloring
+ * above that.
+ */
+void CodeGenerator::EmitWithRegisterAllocator(Mips *mips, CodeUnit *fn)
+{
+    BeginPhase(CfgPhase);
+    ControlFlowGraph cfg(*fn);
+    EndPhase(CfgPhase);
+    RegisterAssignment assignment;
+    BeginPhase(RegAllocPhase);
+    if (OptimizationLevel() == 1)
+        LinearScanAllocator(cfg).Allocate(&assignment);
+    else
+        GraphColorAllocator(cfg).Allocate(&assignment);
+    EndPhase(RegAllocPhase);
+
+    mips->SetRegisterAssignment(&assignment);
+    for (int i = 0; i < cfg.num_instrs(); i++)
+        cfg.instr(i)->Emit(mips);
+    mips->SetRegisterAssignment(NULL);
+}
+
 
 Location *CodeGenerator::GenArrayLen(Location *array)
 {
@@ -484,7 +459,7 @@ Location *CodeGenerator::GenSubscript(Location *array, Location *index)
     Location *four = GenLoadConstant(VarSize);
     Location *offset = GenBinaryOp("*", four, index);
     Location *elem = GenBinaryOp("+", array, offset);
-    return new Location(elem, 0);
+    return GenReference(elem, 0);
 }
 
 
@@ -2,17 +2,23 @@
  * ---------------
  * The CodeGenerator class defines an object that will build Tac
  * instructions (using the Tac class and its subclasses) and store the
- * instructions in a sequential list, ready for further processing or
- * translation to MIPS as part of final code generation.
+ * instructions in sequence, one CodeUnit per function, ready for further
+ * processing or translation to MIPS as part of final code generation.
  */
 
 #ifndef _H_codegen
 #define _H_codegen
 
 #include <cstdlib>
-#include <list>
+#include <vector>
 #include "tac.h"
+#include "codeunit.h"
+#include "arena.h"
+#include "taskpool.h"
+#include "unitcache.h"
 class FnDecl;
+class Mips;
+class Compilation;
  
 
               // These codes are used to identify the built-in functions
@@ -21,10 +27,30 @@ typedef enum { Alloc, ReadLine, ReadInteger, StringEqual,
 
 class CodeGenerator {
   private:
-    std::list<Instruction*> code;
+    std::vector<CodeUnit*> code;   // functions and what lies between
+    CodeUnit *current;              // unit being appended to, if any
+    Arena globals;                  // Locations of globals, used by all units
     int curStackOffset, curGlobalOffset;
+    int nextLabelNum, nextTempNum;  // for unique label and temp names
     BeginFunc *insideFn;
 
+    Arena& Pool();                  // arena of the unit being appended to
+    void Append(Instruction *instr);
+    void EmitWithLiveness(Mips *mips, CodeUnit *fn);
+    void EmitWithRegisterAllocator(Mips *mips, CodeUnit *fn);
+
+    class UnitTranslation : public TaskBatch {
+        Compilation *compilation;      // made current on the workers too
+        CodeGenerator *cg;
+        UnitCache *cache;              // NULL if not caching
+        std::vector<int> firstString;  // number of each unit's first string constant
+        std::vector<std::string> text; // each unit's assembly, until written
+      public:
+        UnitTranslation(CodeGenerator *cg, UnitCache *cache);
+        void Do(int i);
+        void Finish(int i);
+    };
+
   public:
            // Here are some class constants to remind you of the offsets
            // used for globals, locals, and parameters. You will be
@@ -44,10 +70,12 @@ class CodeGenerator {
     static Location* ThisPtr;
 
     CodeGenerator();
+    ~CodeGenerator();
     
-         // Assigns a new unique label name and returns it. Does not
+         // Assigns a new unique label name and returns it (interned,
+         // see intern.h, like all names in the Tac). Does not
          // generate any Tac instructions (see GenLabel below if needed)
-    char *NewLabel();
+    const char *NewLabel();
 
     
          // Creates and returns a Location for a new uniquely named
@@ -56,6 +84,12 @@ class CodeGenerator {
 
     Location *GenLocalVariable(const char *varName);
     Location *GenGlobalVariable(const char *varName);
+
+         // Creates and returns a Location for the word refOffset bytes
+         // past the address held in base. Does not generate any Tac
+         // instructions.
+    Location *GenReference(Location *base, int refOffset);
+
          // Generates Tac instructions to load a constant value. Creates
          // a new temp var to hold the result. The constant 
          // value is passed as an integer, it can be 0 for integer zero,
@@ -166,6 +200,14 @@ class CodeGenerator {
          // flag tac is on (-d tac), it will not translate to MIPS,
          // but instead just print the untranslated Tac. It may be
          // useful in debugging to first make sure your Tac is correct.
+         // With -O1/-O2 each function is run through a register
+         // allocator first (see regalloc.h). Otherwise registers are
+         // picked as each instruction is emitted and a var's register
+         // is freed once liveness analysis says the var is dead.
+         // Units are translated on NumThreads() threads at once and
+         // written in order. With a cache directory (see unitcache.h)
+         // functions translated before are taken from the cache. Each
+         // unit is freed, arena and all, as soon as it is translated.
     void DoFinalCodeGen();
 
     Location *GenNewArray(Location *numElements);
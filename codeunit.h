@@ -0,0 +1,99 @@
+/* File: codeunit.h
+ * ----------------
+ * A CodeUnit holds a run of Tac instructions: either one whole
+ * function (BeginFunc through EndFunc) or the instructions that sit
+ * between functions (function labels, vtables). The CodeGenerator
+ * builds the program as a sequence of units, so the backend can take
+ * one function at a time without scanning for its ends.
+ *
+ * The instructions are kept in one vector of slots linked by index
+ * in program order. Appending is a push_back, and inserting or
+ * removing next to an existing instruction only relinks neighbors,
+ * so optimization passes can rewrite a function in place. A Position
+ * names a slot and stays valid until that instruction is removed.
+ *
+ * Each unit also has an arena (see arena.h) holding its instructions
+ * and everything they point to that is private to the unit: temps,
+ * locals, string constants. Releasing it once the unit has been
+ * translated frees the lot in one step. (The names and labels they
+ * use are interned, see intern.h.)
+ *
+ *   for (CodeUnit::Position p = unit->First(); p != CodeUnit::End; p = unit->Next(p))
+ *       unit->At(p)->Print();
+ */
+
+#ifndef _H_codeunit
+#define _H_codeunit
+
+#include <vector>
+#include "arena.h"
+#include "utility.h"  // for Assert()
+class Instruction;
+
+class CodeUnit
+{
+  public:
+    typedef int Position;
+    static const Position End = -1;
+
+    CodeUnit(bool isFunction) : isFunction(isFunction), name(NULL), head(End), tail(End), count(0) {}
+
+    bool IsFunction() const       { return isFunction; }
+    const char *GetName() const   { return name; }  // a function's label, interned
+    void SetName(const char *n)   { name = n; }
+    int NumInstructions() const   { return count; }
+    Arena *GetArena()             { return &arena; }
+
+    Position First() const        { return head; }
+    Position Last() const         { return tail; }
+    Position Next(Position p) const { return slots[p].next; }
+    Position Prev(Position p) const { return slots[p].prev; }
+    Instruction *At(Position p) const { return slots[p].instr; }
+
+    Position Append(Instruction *instr) { return InsertAfter(tail, instr); }
+
+          // Inserts instr after p (at the front if p is End)
+    Position InsertAfter(Position p, Instruction *instr);
+    void Remove(Position p);
+
+  private:
+    struct Slot {
+        Instruction *instr;  // NULL once removed
+        Position prev, next;
+    };
+
+    bool isFunction;
+    const char *name;
+    std::vector<Slot> slots;
+    Position head, tail;
+    int count;
+    Arena arena;
+};
+
+
+inline CodeUnit::Position CodeUnit::InsertAfter(Position p, Instruction *instr)
+{
+    Assert(instr != NULL);
+    Slot s;
+    s.instr = instr;
+    s.prev = p;
+    s.next = (p == End) ? head : slots[p].next;
+    Position added = slots.size();
+    slots.push_back(s);
+    if (s.prev == End) head = added; else slots[s.prev].next = added;
+    if (s.next == End) tail = added; else slots[s.next].prev = added;
+    count++;
+    return added;
+}
+
+inline void CodeUnit::Remove(Position p)
+{
+    Assert(slots[p].instr != NULL);
+    Slot& s = slots[p];
+    if (s.prev == End) head = s.next; else slots[s.prev].next = s.next;
+    if (s.next == End) tail = s.prev; else slots[s.next].prev = s.prev;
+    s.instr = NULL;
+    count--;
+}
+
+#endif
@@ -0,0 +1,129 @@
+/* File: compilation.cc
+ * --------------------
+ * Implementation of the Compilation class and of CompileDecaf, the
+ * library entry point.
+ */
+
+#include "compilation.h"
+#include <sstream>
+#include <errno.h>
+#include <string.h>
+#include "utility.h"
+#include "scanner.h"
+#include "parser.h"
+#include "timing.h"
+#include "flatast.h"
+
+thread_local Compilation *Compilation::current = NULL;
+
+Compilation::Compilation(const DecafOptions& o, std::ostream& out, std::ostream& err)
+  : options(o), out(out), err(err), numErrors(0),
+    cacheHits(0), cacheMisses(0), source(NULL), sourceLength(0), scanner(NULL),
+    timings(NULL) {}
+
+/* Method: Run
+ * -----------
+ * The tree is built in our arena while the parser runs. Once the parse
+ * is accepted, the Program action checks the tree and generates code
+ * (see parser.y), releasing the tree when it is done with it; if it
+ * never got that far the tree goes here.
+ *
+ * The report and trace of the phase timings, if asked for, cover the
+ * whole run, so they are written at the end of it.
+ */
+void Compilation::Run(const char *source, int length)
+{
+    std::string text(source, length);
+    text.append(2, '\0');
+    RunInPlace(&text[0], length);
+}
+
+void Compilation::RunInPlace(char *text, int length)
+{
+    Assert(current == NULL);
+    current = this;
+    Node::arena = &tree;
+    source = text;
+    sourceLength = length;
+    if (options.timeReport || !options.traceFile.empty()) timings = new Timings;
+    BeginPhase(ParsePhase);
+    scanner = InitScanner(text, length);
+    if (IsDebugOn("tokens")) {
+        DumpTokens(scanner, out);
+    } else if (IsDebugOn("scan")) {
+        out << CountTokens(scanner) << " tokens\n";
+    } else {
+        FlatTree *flat = options.flatAst ? Node::OwnedByTree(new FlatTree) : NULL;
+        InitParser();
+        yyparse(scanner, flat);   // the Program action ends ParsePhase, if it runs
+    }
+    EndPhase(ParsePhase);
+    FreeScanner(scanner);
+    scanner = NULL;
+    Node::ReleaseTree();
+    out.flush();
+    if (timings) {
+        if (options.timeReport) timings->WriteReport(err);
+        if (!options.traceFile.empty() && !timings->WriteTrace(options.traceFile.c_str()))
+            err << "dcc: can't write trace to " << options.traceFile << ": "
+                << strerror(errno) << std::endl;
+        delete timings;
+        timings = NULL;
+    }
+    current = NULL;
+}
+
+bool Compilation::IsDebugOn(const char *key)
+{
+    for (size_t i = 0; i < options.debugKeys.size(); i++)
+        if (options.debugKeys[i] == key) return true;
+    return false;
+}
+
+/* Method: GetLineNumbered
+ * ------------------------
+ * Only errors need the lines, so the table of where each starts is
+ * filled in only as far as the lines asked for. The scanner may be
+ * in the middle of the source, with a char of it held aside.
+ */
+bool Compilation::GetLineNumbered(int n, std::string *line)
+{
+    if (n <= 0 || !source) return false;
+    if (scanner) RestoreSource(scanner);
+    if (lineStarts.empty() && sourceLength > 0) lineStarts.push_back(0);
+    while (lineStarts.size() < n && !lineStarts.empty()) {
+        const char *start = source + lineStarts.back();
+        const char *end = (const char *)memchr(start, '\n', source + sourceLength - start);
+        if (!end || end + 1 == source + sourceLength) break;
+        lineStarts.push_back(end + 1 - source);
+    }
+    bool found = (n <= lineStarts.size());
+    if (found) {
+        const char *start = source + lineStarts[n-1];
+        const char *end = (const char *)memchr(start, '\n', source + sourceLength - start);
+        line->assign(start, end ? end : source + sourceLength);
+    }
+    if (scanner) TerminateToken(scanner);
+    return found;
+}
+
+bool GetLineNumbered(int n, std::string *line)
+{
+    return Compilation::Current()->GetLineNumbered(n, line);
+}
+
+
+DecafResult CompileDecaf(const char *source, size_t length, const DecafOptions& options)
+{
+    std::ostringstream out, err;
+    Compilation compilation(options, out, err);
+    compilation.Run(source, length);
+
+    DecafResult result;
+    result.assembly = out.str();
+    result.diagnostics = err.str();
+    result.numErrors = compilation.NumErrors();
+    result.cacheHits = compilation.CacheHits();
+    result.cacheMisses = compilation.CacheMisses();
+    return result;
+}
@@ -0,0 +1,92 @@
+/* File: compilation.h
+ * -------------------
+ * A Compilation is one run of the compiler over one source program.
+ * It holds everything that belongs to that run: the options, the arena
+ * the tree is built in, the names interned (see intern.h), the source
+ * (for showing the context of errors), the number of errors reported
+ * and the streams the output and the error messages go to. None of it
+ * outlives the run, which is what lets libdecaf (see libdecaf.h)
+ * compile any number of programs in the same process, one after
+ * another or several at once on different threads. dcc itself runs
+ * one Compilation over its source file, writing to stdout and stderr.
+ *
+ * The parts of the compiler that need this state (the scanner, error
+ * reporting, the debug and option queries in utility.h, assembly
+ * output) reach it through Compilation::Current(), the one running on
+ * the calling thread, much as nodes reach the arena through the
+ * per-thread Node::arena. Threads a compilation starts (the back
+ * end's, see codegen.cc) join it with SetCurrent.
+ */
+
+#ifndef _H_compilation
+#define _H_compilation
+
+#include <iostream>
+#include "libdecaf.h"
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "intern.h"
+
+class Timings;
+
+class Compilation
+{
+  public:
+    Compilation(const DecafOptions& options, std::ostream& out, std::ostream& err);
+
+          // Scans, parses, checks and (if there are no errors) translates
+          // the source. One Compilation runs at a time on each thread.
+          // RunInPlace scans the source where it is, so it must be
+          // writable and followed by two nuls (see scanner.h); Run
+          // makes a copy.
+    void Run(const char *source, int length);
+    void RunInPlace(char *source, int length);
+
+    static Compilation *Current()     { return current; }
+    static void SetCurrent(Compilation *c) { current = c; }
+
+    const DecafOptions& Options()     { return options; }
+    bool IsDebugOn(const char *key);
+    InternTable *Names()              { return &names; }
+    std::ostream& Output()            { return out; }
+    std::ostream& Errors()            { return err; }
+
+    int NumErrors()                   { return numErrors; }
+    void CountError()                 { numErrors++; }
+
+          // Functions the back end found and did not find in the
+          // cache (see unitcache.h), if there is one
+    int CacheHits()                   { return cacheHits; }
+    int CacheMisses()                 { return cacheMisses; }
+    void CountCacheLookups(int hits, int misses)
+        { cacheHits += hits; cacheMisses += misses; }
+
+          // The phase timings (see timing.h) while running, if the
+          // options ask for them, else NULL
+    Timings *GetTimings()             { return timings; }
+
+          // Source lines, numbered from 1, false if there is no line n
+    bool GetLineNumbered(int n, std::string *line);
+
+  private:
+    static thread_local Compilation *current;
+
+    DecafOptions options;
+    std::ostream& out;
+    std::ostream& err;
+    int numErrors;
+    int cacheHits, cacheMisses;
+    Arena tree;                 // the tree being built, see Node::arena
+    InternTable names;
+    const char *source;
+    int sourceLength;
+    void *scanner;              // while there is one
+    std::vector<int> lineStarts; // offsets of the lines found so far
+    Timings *timings;
+
+    Compilation(const Compilation&);   // not copyable
+    void operator=(const Compilation&);
+};
+
+#endif
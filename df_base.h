@@ -1,12 +1,11 @@
 #ifndef _H_DF_BASE
 #define _H_DF_BASE
 
-#include <map>
+#include <vector>
 #include <algorithm>
+#include "utility.h"
 #include "cfg.h"
 
-typedef std::map<const Instruction*, EdgeList> (ControlFlowGraph::*EdgeMap)();
-
 /*==========================================================
  * DataFlow
  * --------
@@ -29,9 +28,10 @@ public:
   // Perform analysis
   void analyze();
 
-  // Retrieve information associated with a particular instruction
-  const ValueType& data_in( const Instruction* i ) { return df_in[i]; }
-  const ValueType& data_out( const Instruction* i ) { return df_out[i]; }
+  // Retrieve information associated with instruction number i (in
+  // the CFG)
+  const ValueType& data_in( int i ) { return df_in[i]; }
+  const ValueType& data_out( int i ) { return df_out[i]; }
 
 protected:
   //// NOTE: These four functions need to be implemented in derived class
@@ -42,65 +42,146 @@ protected:
   // "Empty" value used to accumulate effects
   virtual ValueType top()= 0;
 
-  // Calculate effect a particular instruction has on value
-  virtual ValueType effect(const Instruction* instr, const ValueType& in)= 0;
+  // Apply the effect of instruction number i (in the CFG) to value,
+  // in place
+  virtual void effect(int i, ValueType& value)= 0;
 
-  // Calculate the meet of two values
-  virtual ValueType meet(const ValueType& a, const ValueType& b)= 0;
+  // Meet other into value, in place
+  virtual void meet(ValueType& value, const ValueType& other)= 0;
 
 private:
+  void effect_of_block( int b, ValueType& value );
+
   FlowType flow;
-  std::map<const Instruction*, ValueType> df_in;
-  std::map<const Instruction*, ValueType> df_out;
+  // Values per instruction, indexed by the CFG's instruction number
+  std::vector<ValueType> df_in;
+  std::vector<ValueType> df_out;
 };
 
+/*----------------------------------------------------------
+ * Effect of a whole basic block on value: the instructions' effects
+ * in turn
+ */
+template <typename ValueType, typename FlowType>
+void DataFlow<ValueType, FlowType>::effect_of_block( int b, ValueType& value )
+{
+  for (int i= flow.block_first(b); ; i+= flow.step())
+  {
+    effect(i, value);
+    if (i == flow.block_last(b))
+      break;
+  }
+}
+
 /*----------------------------------------------------------
  * Perform data flow analysis
+ *
+ * Runs over basic blocks. They are visited in reverse postorder of
+ * the flow (so in postorder of the CFG for ReverseFlow), which sees
+ * every predecessor before its successors except along loop back
+ * edges. Each sweep revisits only the blocks flagged as pending
+ * because an input changed, so it settles after about (loop nesting
+ * + 2) sweeps. The values for each instruction are then filled in by
+ * one more pass through each block.
  */
 template <typename ValueType, typename FlowType>
 void DataFlow<ValueType, FlowType>::analyze()
 {
-  // Initialize worklist with all instructions (except first)
-  // Initialize value for all instructions
-  std::list<Instruction*> worklist;
-  {
-    typename FlowType::iterator p= flow.first();
-    df_in[*p]= init();
-    df_out[*p]= effect(*p, init());
+  ControlFlowGraph& cfg= flow.graph();
+  int n= flow.num_blocks(), entry= flow.entry();
 
-    while (p != flow.last())
+  // Reverse postorder from the entry block, then anything it cannot
+  // reach (e.g. code that never gets to EndFunc) in block order
+  std::vector<int> order;
+  {
+    std::vector<bool> visited(n, false);
+    std::vector< std::pair<int, const int*> > stack; // (block, next successor)
+    visited[entry]= true;
+    stack.push_back(std::make_pair(entry, flow.out_begin(entry)));
+    while (!stack.empty())
     {
-      ++p;
-      df_in[*p]= top();
-      df_out[*p]= effect(*p, top());
-      worklist.push_back( *p );
+      int b= stack.back().first;
+      if (stack.back().second != flow.out_end(b))
+      {
+        int s= *stack.back().second++;
+        if (!visited[s])
+        {
+          visited[s]= true;
+          stack.push_back(std::make_pair(s, flow.out_begin(s)));
+        }
+      }
+      else
+      {
+        order.push_back(b);
+        stack.pop_back();
+      }
     }
+    std::reverse(order.begin(), order.end());
+    for (int b= 0; b < n; b++)
+      if (!visited[b])
+        order.push_back(b);
   }
 
-  while (!worklist.empty())
+  // Initialize value for all blocks, pending all but the entry
+  std::vector<ValueType> block_in(n, top()), block_out(n);
+  block_in[entry]= init();
+  for (int b= 0; b < n; b++)
   {
-    Instruction* i= worklist.front();
-    worklist.pop_front();
+    block_out[b]= block_in[b];
+    effect_of_block(b, block_out[b]);
+  }
 
-    // Calculate meet of df_out for all incoming edges
-    ValueType total_in= top();
-    EdgeList& prev_edges= flow.in()[i];
-    for (EdgeList::iterator p= prev_edges.begin(); p != prev_edges.end(); ++p)
-      total_in= meet(total_in, df_out[*p]);
+  std::vector<bool> pending(n, true);
+  pending[entry]= false;
+  int num_pending= n - 1;
 
-    // If we changed something, reseed worklist
-    if (total_in != df_in[i])
+  while (num_pending > 0)
+  {
+    for (int k= 0; k < n; k++)
     {
-      df_in[i]= total_in;
-      df_out[i]= effect(i, total_in);
-      EdgeList& next_edges= flow.out()[i];
-      for (EdgeList::iterator n= next_edges.begin(); n != next_edges.end(); ++n)
+      int b= order[k];
+      if (!pending[b])
+        continue;
+      pending[b]= false;
+      num_pending--;
+
+      // Calculate meet of block_out for all incoming edges
+      ValueType total_in= top();
+      for (const int* p= flow.in_begin(b); p != flow.in_end(b); ++p)
+        meet(total_in, block_out[*p]);
+
+      // If we changed something, flag the successors
+      if (total_in != block_in[b])
       {
-        if (find(worklist.begin(), worklist.end(), *n) == worklist.end())
-          worklist.push_back(*n);
+        block_in[b]= total_in;
+        block_out[b]= total_in;
+        effect_of_block(b, block_out[b]);
+        for (const int* s= flow.out_begin(b); s != flow.out_end(b); ++s)
+        {
+          if (*s != entry && !pending[*s])
+          {
+            pending[*s]= true;
+            num_pending++;
+          }
+        }
       }
     }
   }
+
+  df_in.resize(cfg.num_instrs());
+  df_out.resize(cfg.num_instrs());
+  for (int b= 0; b < n; b++)
+  {
+    ValueType value= block_in[b];
+    for (int i= flow.block_first(b); ; i+= flow.step())
+    {
+      df_in[i]= value;
+      effect(i, value);
+      df_out[i]= value;
+      if (i == flow.block_last(b))
+        break;
+    }
+  }
 }
 
 #endif
@@ -15,28 +15,37 @@ using namespace std;
 #include "ast_expr.h"
 #include "ast_stmt.h"
 #include "ast_decl.h"
+#include "compilation.h"
+#include "flatast.h"
 
-int ReportError::numErrors = 0;
+int ReportError::NumErrors() {
+    return Compilation::Current()->NumErrors();
+}
 
 void ReportError::UnderlineErrorInLine(const char *line, yyltype *pos) {
     if (!line) return;
-    cerr << line << endl;
+    ostream& err = Compilation::Current()->Errors();
+    err << line << endl;
     for (int i = 1; i <= pos->last_column; i++)
-        cerr << (i >= pos->first_column ? '^' : ' ');
-    cerr << endl;
+        err << (i >= pos->first_column ? '^' : ' ');
+    err << endl;
 }
 
  
  
 void ReportError::OutputError(yyltype *loc, string msg) {
-    numErrors++;
-    fflush(stdout); // make sure any buffered text has been output
+    Compilation *c = Compilation::Current();
+    c->CountError();
+    c->Output().flush(); // make sure any buffered text has been output
+    ostream& err = c->Errors();
     if (loc) {
-        cerr << endl << "*** Error line " << loc->first_line << "." << endl;
-        UnderlineErrorInLine(GetLineNumbered(loc->first_line), loc);
+        err << endl << "*** Error line " << loc->first_line << "." << endl;
+        std::string line;
+        if (GetLineNumbered(loc->first_line, &line))
+            UnderlineErrorInLine(line.c_str(), loc);
     } else
-        cerr << endl << "*** Error." << endl;
-    cerr << "*** " << msg << endl << endl;
+        err << endl << "*** Error." << endl;
+    err << "*** " << msg << endl << endl;
 }
 
 
@@ -97,85 +106,145 @@ void ReportError::InterfaceNotImplemented(Decl *cd, Type *interfaceType) {
 }
 
 void ReportError::IdentifierNotDeclared(Identifier *ident, reasonT whyNeeded) {
+    IdentifierNotDeclared(ident->GetLocation(), ident->GetName(), whyNeeded);
+}
+
+void ReportError::IdentifierNotDeclared(yyltype *loc, const char *name, reasonT whyNeeded) {
     stringstream s;
     static const char *names[] =  {"type", "class", "interface", "variable", "function"};
     Assert(whyNeeded >= 0 && whyNeeded <= sizeof(names)/sizeof(names[0]));
-    s << "No declaration found for "<< names[whyNeeded] << " '" << ident << "'";
-    OutputError(ident->GetLocation(), s.str());
+    s << "No declaration found for "<< names[whyNeeded] << " '" << name << "'";
+    OutputError(loc, s.str());
 }
 
 void ReportError::IncompatibleOperands(Operator *op, Type *lhs, Type *rhs) {
+    IncompatibleOperands(op->GetLocation(), op->str(), lhs, rhs);
+}
+
+void ReportError::IncompatibleOperands(yyltype *opLoc, const char *op, Type *lhs, Type *rhs) {
     stringstream s;
     s << "Incompatible operands: " << lhs << " " << op << " " << rhs;
-    OutputError(op->GetLocation(), s.str());
+    OutputError(opLoc, s.str());
 }
      
 void ReportError::IncompatibleOperand(Operator *op, Type *rhs) {
+    IncompatibleOperand(op->GetLocation(), op->str(), rhs);
+}
+
+void ReportError::IncompatibleOperand(yyltype *opLoc, const char *op, Type *rhs) {
     stringstream s;
     s << "Incompatible operand: " << op << " " << rhs;
-    OutputError(op->GetLocation(), s.str());
+    OutputError(opLoc, s.str());
 }
 
 void ReportError::ThisOutsideClassScope(This *th) {
-    OutputError(th->GetLocation(), "'this' is only valid within class scope");
+    ThisOutsideClassScope(th->GetLocation());
+}
+
+void ReportError::ThisOutsideClassScope(yyltype *loc) {
+    OutputError(loc, "'this' is only valid within class scope");
 }
 
 void ReportError::BracketsOnNonArray(Expr *baseExpr) {
-    OutputError(baseExpr->GetLocation(), "[] can only be applied to arrays");
+    BracketsOnNonArray(baseExpr->GetLocation());
+}
+
+void ReportError::BracketsOnNonArray(yyltype *baseLoc) {
+    OutputError(baseLoc, "[] can only be applied to arrays");
 }
 
 void ReportError::SubscriptNotInteger(Expr *subscriptExpr) {
-    OutputError(subscriptExpr->GetLocation(), "Array subscript must be an integer");
+    SubscriptNotInteger(subscriptExpr->GetLocation());
+}
+
+void ReportError::SubscriptNotInteger(yyltype *subscriptLoc) {
+    OutputError(subscriptLoc, "Array subscript must be an integer");
 }
 
 void ReportError::NewArraySizeNotInteger(Expr *sizeExpr) {
-    OutputError(sizeExpr->GetLocation(), "Size for NewArray must be an integer");
+    NewArraySizeNotInteger(sizeExpr->GetLocation());
+}
+
+void ReportError::NewArraySizeNotInteger(yyltype *sizeLoc) {
+    OutputError(sizeLoc, "Size for NewArray must be an integer");
 }
 
 void ReportError::NumArgsMismatch(Identifier *fnIdent, int numExpected, int numGiven) {
+    NumArgsMismatch(fnIdent->GetLocation(), fnIdent->GetName(), numExpected, numGiven);
+}
+
+void ReportError::NumArgsMismatch(yyltype *fnLoc, const char *fnName, int numExpected, int numGiven) {
     stringstream s;
-    s << "Function '"<< fnIdent << "' expects " << numExpected << " argument" << (numExpected==1?"":"s") 
+    s << "Function '"<< fnName << "' expects " << numExpected << " argument" << (numExpected==1?"":"s") 
       << " but " << numGiven << " given";
-    OutputError(fnIdent->GetLocation(), s.str());
+    OutputError(fnLoc, s.str());
 }
 
 void ReportError::ArgMismatch(Expr *arg, int argIndex, Type *given, Type *expected) {
+    ArgMismatch(arg->GetLocation(), argIndex, given, expected);
+}
+
+void ReportError::ArgMismatch(yyltype *argLoc, int argIndex, Type *given, Type *expected) {
   stringstream s;
   s << "Incompatible argument " << argIndex << ": " << given << " given, " << expected << " expected";
-  OutputError(arg->GetLocation(), s.str());
+  OutputError(argLoc, s.str());
 }
 
 void ReportError::ReturnMismatch(ReturnStmt *rStmt, Type *given, Type *expected) {
+    ReturnMismatch(rStmt->GetLocation(), given, expected);
+}
+
+void ReportError::ReturnMismatch(yyltype *returnLoc, Type *given, Type *expected) {
     stringstream s;
     s << "Incompatible return: " << given << " given, " << expected << " expected";
-    OutputError(rStmt->GetLocation(), s.str());
+    OutputError(returnLoc, s.str());
 }
 
 void ReportError::FieldNotFoundInBase(Identifier *field, Type *base) {
+    FieldNotFoundInBase(field->GetLocation(), field->GetName(), base);
+}
+
+void ReportError::FieldNotFoundInBase(yyltype *fieldLoc, const char *field, Type *base) {
     stringstream s;
     s << base << " has no such field '" << field <<"'";
-    OutputError(field->GetLocation(), s.str());
+    OutputError(fieldLoc, s.str());
 }
      
 void ReportError::InaccessibleField(Identifier *field, Type *base) {
+    InaccessibleField(field->GetLocation(), field->GetName(), base);
+}
+
+void ReportError::InaccessibleField(yyltype *fieldLoc, const char *field, Type *base) {
     stringstream s;
     s  << base << " field '" << field << "' only accessible within class scope";
-    OutputError(field->GetLocation(), s.str());
+    OutputError(fieldLoc, s.str());
 }
 
 void ReportError::PrintArgMismatch(Expr *arg, int argIndex, Type *given) {
+    PrintArgMismatch(arg->GetLocation(), argIndex, given);
+}
+
+void ReportError::PrintArgMismatch(yyltype *argLoc, int argIndex, Type *given) {
     stringstream s;
     s << "Incompatible argument " << argIndex << ": " << given
         << " given, int/bool/string expected";
-    OutputError(arg->GetLocation(), s.str());
+    OutputError(argLoc, s.str());
 }
 
 void ReportError::TestNotBoolean(Expr *expr) {
-    OutputError(expr->GetLocation(), "Test expression must have boolean type");
+    TestNotBoolean(expr->GetLocation());
+}
+
+void ReportError::TestNotBoolean(yyltype *testLoc) {
+    OutputError(testLoc, "Test expression must have boolean type");
 }
 
 void ReportError::BreakOutsideLoop(BreakStmt *bStmt) {
-    OutputError(bStmt->GetLocation(), "break is only allowed inside a loop");
+    BreakOutsideLoop(bStmt->GetLocation());
+}
+
+void ReportError::BreakOutsideLoop(yyltype *breakLoc) {
+    OutputError(breakLoc, "break is only allowed inside a loop");
 }
   
 void ReportError::NoMainFound() {
@@ -186,11 +255,11 @@ void ReportError::NoMainFound() {
  * -------------------
  * Standard error-reporting function expected by yacc. Our version merely
  * just calls into the error reporter above, passing the location of
- * the last token read. If you want to suppress the ordinary "parse error"
+ * the last token read (which the pure parser hands us). If you want to suppress the ordinary "parse error"
  * message from yacc, you can implement yyerror to do nothing and
  * then call ReportError::Formatted yourself with a more descriptive 
  * message.
  */
-void yyerror(const char *msg) {
-    ReportError::Formatted(&yylloc, "%s", msg);
+void yyerror(yyltype *loc, void *scanner, FlatTree *flat, const char *msg) {
+    ReportError::Formatted(loc, "%s", msg);
 }
@@ -33,14 +33,16 @@ class Operator;
  * on this class are static, thus you can invoke methods directly via
  * the class name, e.g.
  *
- *    if (missingEnd) ReportError::UntermString(&yylloc, str);
+ *    if (missingEnd) ReportError::UntermString(yylloc, str);
  *
  * For some methods, the first argument is the pointer to the location
  * structure that identifies where the problem is (usually this is the
  * location of the offending token). You can pass NULL for the argument
  * if there is no appropriate position to point out. For other methods,
  * location is accessed by messaging the node in error which is passed
- * as an argument. You cannot pass NULL for these arguments.
+ * as an argument. You cannot pass NULL for these arguments. Those also
+ * come in a form taking the location (and name or operator) instead,
+ * for function bodies built flat, which have no nodes (see flatast.h).
  */
 
 
@@ -69,35 +71,50 @@ class ReportError
 
   // Errors used by semantic analyzer for identifiers
   static void IdentifierNotDeclared(Identifier *ident, reasonT whyNeeded);
+  static void IdentifierNotDeclared(yyltype *loc, const char *name, reasonT whyNeeded);
 
   
   // Errors used by semantic analyzer for expressions
   static void IncompatibleOperand(Operator *op, Type *rhs); // unary
   static void IncompatibleOperands(Operator *op, Type *lhs, Type *rhs); // binary
   static void ThisOutsideClassScope(This *th);
+  static void IncompatibleOperand(yyltype *opLoc, const char *op, Type *rhs);
+  static void IncompatibleOperands(yyltype *opLoc, const char *op, Type *lhs, Type *rhs);
+  static void ThisOutsideClassScope(yyltype *loc);
 
   
  // Errors used by semantic analyzer for array acesss & NewArray
   static void BracketsOnNonArray(Expr *baseExpr); 
   static void SubscriptNotInteger(Expr *subscriptExpr);
   static void NewArraySizeNotInteger(Expr *sizeExpr);
+  static void BracketsOnNonArray(yyltype *baseLoc);
+  static void SubscriptNotInteger(yyltype *subscriptLoc);
+  static void NewArraySizeNotInteger(yyltype *sizeLoc);
 
 
   // Errors used by semantic analyzer for function/method calls
   static void NumArgsMismatch(Identifier *fnIdentifier, int numExpected, int numGiven);
   static void ArgMismatch(Expr *arg, int argIndex, Type *given, Type *expected);
   static void PrintArgMismatch(Expr *arg, int argIndex, Type *given);
+  static void NumArgsMismatch(yyltype *fnLoc, const char *fnName, int numExpected, int numGiven);
+  static void ArgMismatch(yyltype *argLoc, int argIndex, Type *given, Type *expected);
+  static void PrintArgMismatch(yyltype *argLoc, int argIndex, Type *given);
 
 
   // Errors used by semantic analyzer for field access
   static void FieldNotFoundInBase(Identifier *field, Type *base);
   static void InaccessibleField(Identifier *field, Type *base);
+  static void FieldNotFoundInBase(yyltype *fieldLoc, const char *field, Type *base);
+  static void InaccessibleField(yyltype *fieldLoc, const char *field, Type *base);
 
 
   // Errors used by semantic analyzer for control structures
   static void TestNotBoolean(Expr *testExpr);
   static void ReturnMismatch(ReturnStmt *rStmt, Type *given, Type *expected);
   static void BreakOutsideLoop(BreakStmt *bStmt);
+  static void TestNotBoolean(yyltype *testLoc);
+  static void ReturnMismatch(yyltype *returnLoc, Type *given, Type *expected);
+  static void BreakOutsideLoop(yyltype *breakLoc);
 
 
     // Errors used by code-generator/linker
@@ -107,14 +124,13 @@ class ReportError
   static void Formatted(yyltype *loc, const char *format, ...);
 
 
-  // Returns number of error messages printed
-  static int NumErrors() { return numErrors; }
+  // Returns number of error messages printed (by the current compilation)
+  static int NumErrors();
   
  private:
 
   static void UnderlineErrorInLine(const char *line, yyltype *pos);
   static void OutputError(yyltype *loc, string msg);
-  static int numErrors;
   
 };
 
@@ -0,0 +1,731 @@
+/* File: flatast.cc
+ * ----------------
+ * Implementation of the flat tree. Each case below follows the node
+ * class it stands for in ast_expr.cc and ast_stmt.cc, in the same
+ * order, so a body gives the same errors and the same TAC either way.
+ */
+
+#include "flatast.h"
+#include <string.h>
+#include "ast.h"
+#include "ast_type.h"
+#include "ast_decl.h"
+#include "ast_expr.h"
+#include "scope.h"
+#include "errors.h"
+#include "codegen.h"
+#include "intern.h"
+
+  // As written in the source, for the operators (Negate to Assign)
+static const char * const operatorName[FlatTree::NumKinds] = {
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    "-", "+", "-", "*", "/", "%",
+    "<", ">", "<=", ">=",
+    "==", "!=",
+    "!", "&&", "||",
+    "=" };
+
+const int FlatTree::None;
+
+FlatTree::FlatTree()
+  : fn(NULL), enclosingClass(NULL), scopes(NULL), cg(NULL), loopDepth(0), loopExit(NULL) {}
+
+/* Method: AddNode
+ * ---------------
+ * Adds a node with no kids yet: the caller appends them to kids right
+ * away, before adding any other node. The value is, by kind: the int
+ * or bool for a constant, the index in strings for a string, in names
+ * for a field, call or new, in elemTypes for a new array and in
+ * blockDecls for a block, and the location of the operator for an
+ * operation.
+ */
+int FlatTree::AddNode(Kind k, int loc, int v)
+{
+    int n = kind.size();
+    kind.push_back(k);
+    location.push_back(loc);
+    type.push_back(None);
+    value.push_back(v);
+    firstKid.push_back(kids.size());
+    return n;
+}
+
+int FlatTree::AddName(yyltype loc, const char *name)
+{
+    Name added = { Intern(name), Node::AddLocation(loc), NULL, false };
+    names.push_back(added);
+    return names.size() - 1;
+}
+
+int FlatTree::NumKids(int n) const
+{
+    int end = (n + 1 < (int)firstKid.size()) ? firstKid[n + 1] : kids.size();
+    return end - firstKid[n];
+}
+
+yyltype *FlatTree::LocationOf(int n)
+{
+    return location[n] == None ? NULL : Node::LocationAt(location[n]);
+}
+
+void FlatTree::SetType(int n, Type *t)
+{
+    std::unordered_map<Type*, int>::iterator found = typeIds.find(t);
+    if (found == typeIds.end()) {
+        found = typeIds.insert(std::make_pair(t, (int)types.size())).first;
+        types.push_back(t);
+    }
+    type[n] = found->second;
+}
+
+
+int FlatTree::Empty()
+{
+    return AddNode(NoExpr, None, 0);
+}
+
+int FlatTree::Constant(Kind k, yyltype loc, int v)
+{
+    return AddNode(k, Node::AddLocation(loc), v);
+}
+
+int FlatTree::String(yyltype loc, const char *s)
+{
+    Assert(s != NULL);
+    strings.push_back(Node::CopyString(s));
+    return AddNode(StringLit, Node::AddLocation(loc), strings.size() - 1);
+}
+
+int FlatTree::Leaf(Kind k, yyltype loc)
+{
+    return AddNode(k, Node::AddLocation(loc), 0);
+}
+
+int FlatTree::Operation(yyltype opLoc, const char *op, int left, int right)
+{
+    Kind k = NumKinds;
+    for (int i = Negate; i <= Assign; i++)
+        if (!strcmp(op, operatorName[i]) && (i == Negate || i == Not) == (left == None))
+            k = (Kind)i;
+    Assert(k != NumKinds);
+    yyltype whole = Join(left == None ? &opLoc : LocationOf(left), LocationOf(right));
+    int n = AddNode(k, Node::AddLocation(whole), Node::AddLocation(opLoc));
+    if (left != None) kids.push_back(left);
+    kids.push_back(right);
+    return n;
+}
+
+int FlatTree::Field(int base, yyltype fieldLoc, const char *field)
+{
+    yyltype whole = (base == None) ? fieldLoc : Join(LocationOf(base), &fieldLoc);
+    int n = AddNode(FieldRef, Node::AddLocation(whole), AddName(fieldLoc, field));
+    if (base != None) kids.push_back(base);
+    return n;
+}
+
+int FlatTree::Index(yyltype loc, int base, int subscript)
+{
+    int n = AddNode(Subscript, Node::AddLocation(loc), 0);
+    kids.push_back(base);
+    kids.push_back(subscript);
+    return n;
+}
+
+int FlatTree::Call(yyltype loc, int base, yyltype fieldLoc, const char *field, List<int> *actuals)
+{
+    int n = AddNode(FnCall, Node::AddLocation(loc), AddName(fieldLoc, field));
+    kids.push_back(base);
+    for (int i = 0; i < actuals->NumElements(); i++)
+        kids.push_back(actuals->Nth(i));
+    return n;
+}
+
+int FlatTree::New(yyltype loc, yyltype classLoc, const char *className)
+{
+    return AddNode(NewObject, Node::AddLocation(loc), AddName(classLoc, className));
+}
+
+int FlatTree::NewArray(yyltype loc, int size, Type *elemType)
+{
+    elemTypes.push_back(elemType);
+    int n = AddNode(NewArrayOf, Node::AddLocation(loc), elemTypes.size() - 1);
+    kids.push_back(size);
+    return n;
+}
+
+int FlatTree::Block(List<VarDecl*> *decls, List<int> *stmts)
+{
+    blockDecls.push_back(decls);
+    int n = AddNode(BlockStmt, None, blockDecls.size() - 1);
+    for (int i = 0; i < stmts->NumElements(); i++)
+        kids.push_back(stmts->Nth(i));
+    return n;
+}
+
+int FlatTree::If(int test, int thenBody, int elseBody)
+{
+    int n = AddNode(IfElse, None, 0);
+    kids.push_back(test);
+    kids.push_back(thenBody);
+    kids.push_back(elseBody);
+    return n;
+}
+
+int FlatTree::While(int test, int body)
+{
+    int n = AddNode(WhileLoop, None, 0);
+    kids.push_back(test);
+    kids.push_back(body);
+    return n;
+}
+
+int FlatTree::For(int init, int test, int step, int body)
+{
+    int n = AddNode(ForLoop, None, 0);
+    kids.push_back(init);
+    kids.push_back(test);
+    kids.push_back(step);
+    kids.push_back(body);
+    return n;
+}
+
+int FlatTree::Break(yyltype loc)
+{
+    return AddNode(BreakLoop, Node::AddLocation(loc), 0);
+}
+
+int FlatTree::Return(yyltype loc, int expr)
+{
+    int n = AddNode(ReturnValue, Node::AddLocation(loc), 0);
+    kids.push_back(expr);
+    return n;
+}
+
+int FlatTree::Print(List<int> *args)
+{
+    int n = AddNode(PrintArgs, None, 0);
+    for (int i = 0; i < args->NumElements(); i++)
+        kids.push_back(args->Nth(i));
+    return n;
+}
+
+
+void FlatTree::Bind(FnDecl *f, int block, ScopeStack *s)
+{
+    fn = f;
+    scopes = s;
+    BindNode(block);
+    scopes = NULL;
+}
+
+/* Method: BindNode
+ * ----------------
+ * Names with no base are looked up now, those with one once the type
+ * of the base is known (see FieldDecl). Blocks declare their locals,
+ * which are parented to the function as they have no block node.
+ */
+void FlatTree::BindNode(int n)
+{
+    switch (kind[n]) {
+      case BlockStmt: {
+        List<VarDecl*> *decls = blockDecls[value[n]];
+        Scope *scope = Node::OwnedByTree(new Scope());
+        decls->SetParentAll(fn);
+        decls->DeclareAll(scope);
+        scopes->Push(scope);
+        decls->BindAll(scopes);
+        for (int i = 0; i < NumKids(n); i++)
+            BindNode(Kid(n, i));
+        scopes->Pop();
+        return;
+      }
+      case FieldRef:
+        if (NumKids(n) == 0) {
+            Name& name = names[value[n]];
+            name.decl = scopes->Lookup(name.name);
+        }
+        break;
+      case FnCall:
+        if (Kid(n, 0) == None) {
+            Name& name = names[value[n]];
+            name.decl = scopes->Lookup(name.name);
+        }
+        break;
+      case NewObject: {
+        Name& name = names[value[n]];
+        name.decl = scopes->Lookup(name.name);
+        return;
+      }
+      case NewArrayOf: {
+        BindNode(Kid(n, 0));
+        Type *&elemType = elemTypes[value[n]];
+        elemType->Bind(scopes);
+        elemType = elemType->Canonical();
+        return;
+      }
+    }
+    for (int i = 0; i < NumKids(n); i++)
+        if (Kid(n, i) != None) BindNode(Kid(n, i));
+}
+
+/* Method: FieldDecl
+ * -----------------
+ * As Identifier::GetDeclRelativeToBase: with no base, what binding
+ * found, with one the field of that name in the base's class or
+ * interface, remembered in name.
+ */
+Decl *FlatTree::FieldDecl(Name& name, Type *baseType)
+{
+    if (!name.decl && baseType) {
+        if (!baseType->IsNamedType())
+            return NULL;
+        Decl *cd = dynamic_cast<NamedType*>(baseType)->GetDeclForType();
+        Scope *fields = (cd ? cd->PrepareScope() : NULL);
+        name.decl = (fields ? fields->Lookup(name.name) : NULL);
+    }
+    return name.decl;
+}
+
+
+void FlatTree::Check(FnDecl *f, int block)
+{
+    fn = f;
+    enclosingClass = dynamic_cast<ClassDecl*>(fn->GetParent());
+    loopDepth = 0;
+    CheckStmt(block);
+}
+
+void FlatTree::CheckTest(int test)
+{
+    if (!CheckExpr(test)->IsCompatibleWith(Type::boolType))
+        ReportError::TestNotBoolean(LocationOf(test));
+}
+
+void FlatTree::CheckStmt(int n)
+{
+    switch (kind[n]) {
+      case BlockStmt:
+        blockDecls[value[n]]->CheckAll();
+        for (int i = 0; i < NumKids(n); i++)
+            CheckStmt(Kid(n, i));
+        return;
+      case IfElse:
+        CheckTest(Kid(n, 0));
+        CheckStmt(Kid(n, 1));
+        if (Kid(n, 2) != None) CheckStmt(Kid(n, 2));
+        return;
+      case WhileLoop:
+        CheckTest(Kid(n, 0));
+        loopDepth++;
+        CheckStmt(Kid(n, 1));
+        loopDepth--;
+        return;
+      case ForLoop:
+        CheckExpr(Kid(n, 0));
+        CheckTest(Kid(n, 1));
+        loopDepth++;
+        CheckStmt(Kid(n, 3));
+        loopDepth--;
+        CheckExpr(Kid(n, 2));
+        return;
+      case BreakLoop:
+        if (loopDepth == 0)
+            ReportError::BreakOutsideLoop(LocationOf(n));
+        return;
+      case ReturnValue: {
+        Type *got = CheckExpr(Kid(n, 0));
+        Type *expected = fn->GetReturnType();
+        if (!got->IsCompatibleWith(expected))
+            ReportError::ReturnMismatch(LocationOf(n), got, expected);
+        return;
+      }
+      case PrintArgs:
+        for (int i = 0; i < NumKids(n); i++) {
+            Type *t = CheckExpr(Kid(n, i));
+            if (t->IsEquivalentTo(Type::errorType)) continue;
+            if (!(t->IsEquivalentTo(Type::intType) || t->IsEquivalentTo(Type::stringType) ||
+                  t->IsEquivalentTo(Type::boolType)))
+                ReportError::PrintArgMismatch(LocationOf(Kid(n, i)), i + 1, t);
+        }
+        return;
+      default:
+        CheckExpr(n);
+    }
+}
+
+Type *FlatTree::CheckExpr(int n)
+{
+    if (type[n] == None)
+        SetType(n, ComputeType(n));
+    return TypeOf(n);
+}
+
+void FlatTree::ReportIncompatible(int n, Type *lhs, Type *rhs)
+{
+    yyltype *opLoc = Node::LocationAt(value[n]);
+    if (!lhs)
+        ReportError::IncompatibleOperand(opLoc, operatorName[kind[n]], rhs);
+    else
+        ReportError::IncompatibleOperands(opLoc, operatorName[kind[n]], lhs, rhs);
+}
+
+Type *FlatTree::ThisType(yyltype *loc)
+{
+    if (!enclosingClass) {
+        ReportError::ThisOutsideClassScope(loc);
+        return Type::errorType;
+    }
+    return enclosingClass->GetDeclaredType();
+}
+
+/* Method: ComputeType
+ * -------------------
+ * The ComputeResultType of each expression class, reporting the same
+ * errors. A field or method of this named with no base is marked as
+ * such (implicitThis) for Emit, where the node would have added a This.
+ */
+Type *FlatTree::ComputeType(int n)
+{
+    switch (kind[n]) {
+      case NoExpr:       return Type::voidType;
+      case IntLit:       return Type::intType;
+      case BoolLit:      return Type::boolType;
+      case StringLit:    return Type::stringType;
+      case NullLit:      return Type::nullType;
+      case ReadIntCall:  return Type::intType;
+      case ReadLineCall: return Type::stringType;
+      case ThisRef:      return ThisType(LocationOf(n));
+
+      case Negate: case Add: case Subtract: case Multiply: case Divide: case Modulo: {
+        Type *lhs = (kind[n] == Negate) ? NULL : CheckExpr(Kid(n, 0));
+        Type *rhs = CheckExpr(Kid(n, NumKids(n) - 1));
+        if ((lhs && lhs == Type::errorType) || rhs == Type::errorType) return Type::errorType;
+        Type *result = GetResultType(lhs, rhs);
+        if (result == Type::errorType)
+            ReportIncompatible(n, lhs, rhs);
+        return result;
+      }
+      case Less: case Greater: case LessEqual: case GreaterEqual: {
+        Type *lhs = CheckExpr(Kid(n, 0)), *rhs = CheckExpr(Kid(n, 1));
+        if (lhs == Type::errorType || rhs == Type::errorType) return Type::boolType;
+        if (!lhs->IsEquivalentTo(rhs) || !lhs->IsNumeric())
+            ReportIncompatible(n, lhs, rhs);
+        return Type::boolType;
+      }
+      case Equal: case NotEqual: {
+        Type *lhs = CheckExpr(Kid(n, 0)), *rhs = CheckExpr(Kid(n, 1));
+        if (!lhs->IsCompatibleWith(rhs) && !rhs->IsCompatibleWith(lhs))
+            ReportIncompatible(n, lhs, rhs);
+        return Type::boolType;
+      }
+      case Not: case And: case Or: {
+        Type *lhs = (kind[n] == Not) ? NULL : CheckExpr(Kid(n, 0));
+        Type *rhs = CheckExpr(Kid(n, NumKids(n) - 1));
+        if ((lhs && !lhs->IsCompatibleWith(Type::boolType)) || !rhs->IsCompatibleWith(Type::boolType))
+            ReportIncompatible(n, lhs, rhs);
+        return Type::boolType;
+      }
+      case Assign: {
+        Type *lhs = CheckExpr(Kid(n, 0)), *rhs = CheckExpr(Kid(n, 1));
+        if (!rhs->IsCompatibleWith(lhs)) {
+            ReportIncompatible(n, lhs, rhs);
+            return Type::errorType;
+        }
+        return lhs;
+      }
+
+      case Subscript: {
+        int base = Kid(n, 0), subscript = Kid(n, 1);
+        Type *baseT = CheckExpr(base);
+        if (baseT != Type::errorType && !baseT->IsArrayType())
+            ReportError::BracketsOnNonArray(LocationOf(base));
+        if (!CheckExpr(subscript)->IsCompatibleWith(Type::intType))
+            ReportError::SubscriptNotInteger(LocationOf(subscript));
+        return baseT->IsArrayType() ? dynamic_cast<ArrayType*>(baseT)->GetArrayElemType() : Type::errorType;
+      }
+      case FieldRef: {
+        int base = NumKids(n) ? Kid(n, 0) : None;
+        Type *baseType = (base != None) ? CheckExpr(base) : NULL;
+        Name& name = names[value[n]];
+        yyltype *loc = Node::LocationAt(name.location);
+        Decl *ivar = FieldDecl(name, baseType);
+        if (ivar && ivar->IsIvarDecl() && base == None) {
+            name.implicitThis = true;
+            baseType = ThisType(loc);
+        }
+        if (base != None || name.implicitThis) {
+            if (baseType == Type::errorType)
+                return Type::errorType;
+            else if (!ivar || !ivar->IsVarDecl()) {
+                ReportError::FieldNotFoundInBase(loc, name.name, baseType);
+                return Type::errorType;
+            } else {
+                Type *withinClass = (enclosingClass ? enclosingClass->GetDeclaredType() : NULL);
+                if (!withinClass || !withinClass->IsCompatibleWith(baseType)) {
+                    ReportError::InaccessibleField(loc, name.name, baseType);
+                    return Type::errorType;
+                }
+            }
+        } else if (!ivar || !ivar->IsVarDecl()) {
+            ReportError::IdentifierNotDeclared(loc, name.name, LookingForVariable);
+            return Type::errorType;
+        }
+        return dynamic_cast<VarDecl*>(ivar)->GetDeclaredType();
+      }
+      case FnCall: {
+        int base = Kid(n, 0), numActuals = NumKids(n) - 1;
+        Type *baseType = (base != None) ? CheckExpr(base) : NULL;
+        Name& name = names[value[n]];
+        yyltype *loc = Node::LocationAt(name.location);
+        FnDecl *fd = dynamic_cast<FnDecl*>(FieldDecl(name, baseType));
+        if (fd && fd->IsMethodDecl() && base == None) {
+            name.implicitThis = true;
+            baseType = ThisType(loc);
+        }
+        for (int i = 1; i <= numActuals; i++)
+            CheckExpr(Kid(n, i));
+        if (baseType && baseType->IsArrayType() && name.name == Intern("length")) {
+            if (numActuals != 0)
+                ReportError::NumArgsMismatch(loc, name.name, 0, numActuals);
+            return Type::intType;
+        }
+        if (baseType == Type::errorType)
+            return Type::errorType;
+        if (baseType && !fd) {
+            ReportError::FieldNotFoundInBase(loc, name.name, baseType);
+            return Type::errorType;
+        } else if (!fd) {
+            ReportError::IdentifierNotDeclared(loc, name.name, LookingForFunction);
+            return Type::errorType;
+        }
+        List<VarDecl*> *formals = fd->GetFormals();
+        if (formals->NumElements() != numActuals)
+            ReportError::NumArgsMismatch(loc, name.name, formals->NumElements(), numActuals);
+        for (int i = 0; i < formals->NumElements() && i < numActuals; i++) {
+            Type *at = TypeOf(Kid(n, i + 1)), *ft = formals->Nth(i)->GetDeclaredType();
+            if (!at->IsCompatibleWith(ft))
+                ReportError::ArgMismatch(LocationOf(Kid(n, i + 1)), i + 1, at, ft);
+        }
+        return fd->GetReturnType();
+      }
+      case NewObject: {
+        Name& name = names[value[n]];
+        ClassDecl *cd = dynamic_cast<ClassDecl*>(name.decl);
+        if (!cd) {
+            ReportError::IdentifierNotDeclared(Node::LocationAt(name.location), name.name,
+                                               LookingForClass);
+            return Type::errorType;
+        }
+        return cd->GetDeclaredType();
+      }
+      case NewArrayOf: {
+        int size = Kid(n, 0);
+        if (!CheckExpr(size)->IsCompatibleWith(Type::intType))
+            ReportError::NewArraySizeNotInteger(LocationOf(size));
+        Type *elemType = elemTypes[value[n]];
+        elemType->Check();
+        return elemType->ArrayOf();
+      }
+    }
+    Failure("unexpected kind %d in flat tree", kind[n]);
+    return NULL;
+}
+
+
+void FlatTree::Emit(FnDecl *f, int block, CodeGenerator *c)
+{
+    fn = f;
+    cg = c;
+    loopExit = NULL;
+    EmitStmt(block);
+    cg = NULL;
+}
+
+void FlatTree::EmitStmt(int n)
+{
+    switch (kind[n]) {
+      case BlockStmt:
+        blockDecls[value[n]]->EmitAll(cg);
+        for (int i = 0; i < NumKids(n); i++)
+            EmitStmt(Kid(n, i));
+        return;
+      case IfElse: {
+        Location *test = EmitExpr(Kid(n, 0));
+        int elseBody = Kid(n, 2);
+        const char *afterElse = NULL, *elseL = cg->NewLabel();
+        cg->GenIfZ(test, elseL);
+        EmitStmt(Kid(n, 1));
+        if (elseBody != None) {
+            afterElse = cg->NewLabel();
+            cg->GenGoto(afterElse);
+        }
+        cg->GenLabel(elseL);
+        if (elseBody != None) {
+            EmitStmt(elseBody);
+            cg->GenLabel(afterElse);
+        }
+        return;
+      }
+      case WhileLoop: {
+        const char *topLoop = cg->NewLabel(), *outerExit = loopExit;
+        loopExit = cg->NewLabel();
+        cg->GenLabel(topLoop);
+        cg->GenIfZ(EmitExpr(Kid(n, 0)), loopExit);
+        EmitStmt(Kid(n, 1));
+        cg->GenGoto(topLoop);
+        cg->GenLabel(loopExit);
+        loopExit = outerExit;
+        return;
+      }
+      case ForLoop: {
+        EmitExpr(Kid(n, 0));
+        const char *topLoop = cg->NewLabel(), *outerExit = loopExit;
+        loopExit = cg->NewLabel();
+        cg->GenLabel(topLoop);
+        cg->GenIfZ(EmitExpr(Kid(n, 1)), loopExit);
+        EmitStmt(Kid(n, 3));
+        EmitExpr(Kid(n, 2));
+        cg->GenGoto(topLoop);
+        cg->GenLabel(loopExit);
+        loopExit = outerExit;
+        return;
+      }
+      case BreakLoop:
+        cg->GenGoto(loopExit);
+        return;
+      case ReturnValue:
+        cg->GenReturn(EmitExpr(Kid(n, 0)));
+        return;
+      case PrintArgs:
+        for (int i = 0; i < NumKids(n); i++) {
+            Type *argType = TypeOf(Kid(n, i));
+            Location *arg = EmitExpr(Kid(n, i));
+            BuiltIn b = PrintInt;
+            if (argType->IsEquivalentTo(Type::stringType))
+                b = PrintString;
+            else if (argType->IsEquivalentTo(Type::boolType))
+                b = PrintBool;
+            cg->GenBuiltInCall(b, arg);
+        }
+        return;
+      default:
+        EmitExpr(n);
+    }
+}
+
+/* Method: EmitLValue
+ * ------------------
+ * The location of a field or array element, as a reference if it is
+ * in memory (see LValue::EmitWithoutDereference).
+ */
+Location *FlatTree::EmitLValue(int n)
+{
+    if (kind[n] == Subscript) {
+        Location *base = EmitExpr(Kid(n, 0));
+        Location *subscript = EmitExpr(Kid(n, 1));
+        return cg->GenSubscript(base, subscript);
+    }
+    Name& name = names[value[n]];
+    if (NumKids(n))
+        return cg->GenReference(EmitExpr(Kid(n, 0)), name.decl->GetOffset());
+    if (name.implicitThis)
+        return cg->GenReference(CodeGenerator::ThisPtr, name.decl->GetOffset());
+    return dynamic_cast<VarDecl*>(name.decl)->rtLoc;
+}
+
+Location *FlatTree::EmitExpr(int n)
+{
+    switch (kind[n]) {
+      case NoExpr:       return NULL;
+      case IntLit: case BoolLit: case NullLit:
+                         return cg->GenLoadConstant(value[n]);
+      case StringLit:    return cg->GenLoadConstant(strings[value[n]]);
+      case ThisRef:      return CodeGenerator::ThisPtr;
+      case ReadIntCall:  return cg->GenBuiltInCall(ReadInteger);
+      case ReadLineCall: return cg->GenBuiltInCall(ReadLine);
+
+      case Negate: {
+        Location *right = EmitExpr(Kid(n, 0));
+        Location *zero = cg->GenLoadConstant(0);
+        return cg->GenBinaryOp("-", zero, right);
+      }
+      case Not: {
+        Location *right = EmitExpr(Kid(n, 0));
+        Location *zero = cg->GenLoadConstant(0);
+        return cg->GenBinaryOp("==", right, zero);
+      }
+      case Add: case Subtract: case Multiply: case Divide: case Modulo: case And: case Or: {
+        Location *left = EmitExpr(Kid(n, 0));
+        Location *right = EmitExpr(Kid(n, 1));
+        return cg->GenBinaryOp(operatorName[kind[n]], left, right);
+      }
+      case Less: case Greater: case LessEqual: case GreaterEqual: {
+        Location *left = EmitExpr(Kid(n, 0));
+        Location *right = EmitExpr(Kid(n, 1));
+        if (kind[n] == Greater || kind[n] == GreaterEqual) {
+            Location *swap = left;
+            left = right;
+            right = swap;
+        }
+        if (kind[n] == Less || kind[n] == Greater)
+            return cg->GenBinaryOp("<", left, right);
+        Location *less = cg->GenBinaryOp("<", left, right);
+        Location *eq = cg->GenBinaryOp("==", left, right);
+        return cg->GenBinaryOp("||", less, eq);
+      }
+      case Equal: case NotEqual: {
+        Location *left = EmitExpr(Kid(n, 0));
+        Location *right = EmitExpr(Kid(n, 1));
+        Location *result;
+        if (TypeOf(Kid(n, 0)) == Type::stringType)
+            result = cg->GenBuiltInCall(StringEqual, left, right);
+        else
+            result = cg->GenBinaryOp("==", left, right);
+        if (kind[n] == NotEqual) {
+            Location *zero = cg->GenLoadConstant(0);
+            result = cg->GenBinaryOp("==", result, zero);
+        }
+        return result;
+      }
+      case Assign: {
+        Location *left = EmitLValue(Kid(n, 0));
+        Location *right = EmitExpr(Kid(n, 1));
+        if (left->IsReference())
+            cg->GenStore(left->GetBase(), right, left->GetRefOffset());
+        else
+            cg->GenAssign(left, right);
+        return left;
+      }
+
+      case Subscript: case FieldRef: {
+        Location *result = EmitLValue(n);
+        if (result->IsReference())
+            result = cg->GenLoad(result->GetBase(), result->GetRefOffset());
+        return result;
+      }
+      case FnCall: {
+        int base = Kid(n, 0);
+        if (base != None && TypeOf(base)->IsArrayType())  // length()
+            return cg->GenArrayLen(EmitExpr(base));
+        List<Location*> actuals;
+        for (int i = 1; i < NumKids(n); i++)
+            actuals.Append(EmitExpr(Kid(n, i)));
+        bool hasReturn = !TypeOf(n)->IsEquivalentTo(Type::voidType);
+        Name& name = names[value[n]];
+        FnDecl *func = dynamic_cast<FnDecl*>(name.decl);
+        if (base != None)
+            return cg->GenDynamicDispatch(EmitExpr(base), func->GetOffset(), &actuals, hasReturn);
+        if (name.implicitThis)
+            return cg->GenDynamicDispatch(CodeGenerator::ThisPtr, func->GetOffset(), &actuals, hasReturn);
+        return cg->GenFunctionCall(func->GetFunctionLabel(), &actuals, hasReturn);
+      }
+      case NewObject: {
+        ClassDecl *cd = dynamic_cast<ClassDecl*>(names[value[n]].decl);
+        return cg->GenNew(cd->GetClassName(), cd->GetClassSize());
+      }
+      case NewArrayOf:
+        return cg->GenNewArray(EmitExpr(Kid(n, 0)));
+    }
+    Failure("unexpected kind %d in flat tree", kind[n]);
+    return NULL;
+}
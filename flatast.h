@@ -0,0 +1,142 @@
+/* File: flatast.h
+ * ---------------
+ * The FlatTree holds the bodies of the functions when the options ask
+ * for a flat tree (--flat-ast): instead of Stmt and Expr nodes, each
+ * statement and expression is an index, and what the nodes would hold
+ * is kept in parallel arrays indexed by it (the node's kind, location
+ * and type, and one value whose meaning depends on the kind), with the
+ * children of node i at kids[firstKid[i]] up to kids[firstKid[i+1]].
+ * The declarations (classes, functions and their formals, the locals
+ * of each block) stay nodes, see ast_decl.h.
+ *
+ * The parser actions add the nodes bottom up (see parser.y), so the
+ * children of a node always come before it. Binding, checking and code
+ * generation are switches on the kind walking the indices, with the
+ * same results as the nodes they stand for would give: the same names
+ * found, errors reported in the same order, the same TAC.
+ *
+ * Locations are kept in the same table as the nodes' (see ast.h) and
+ * a type as its number in the tree's table of types. A name (of a
+ * field, function or class) is an index in names, which holds what
+ * it was bound to. Everything goes with the tree (see Node::arena).
+ *
+ *   FlatTree *flat = Node::OwnedByTree(new FlatTree);
+ *   int one = flat->Constant(FlatTree::IntLit, loc, 1);
+ *   fn->SetFlatBody(flat, flat->Block(decls, stmts));
+ */
+
+#ifndef _H_flatast
+#define _H_flatast
+
+#include <vector>
+#include <unordered_map>
+#include "location.h"
+#include "list.h"
+
+class Type;
+class Decl;
+class VarDecl;
+class FnDecl;
+class ClassDecl;
+class ScopeStack;
+class CodeGenerator;
+class Location;
+
+class FlatTree
+{
+  public:
+    typedef enum {
+        NoExpr, IntLit, BoolLit, StringLit, NullLit, ThisRef, ReadIntCall, ReadLineCall,
+        Negate, Add, Subtract, Multiply, Divide, Modulo,     // arithmetic
+        Less, Greater, LessEqual, GreaterEqual,              // relational
+        Equal, NotEqual,                                     // equality
+        Not, And, Or,                                        // logical
+        Assign, Subscript, FieldRef, FnCall, NewObject, NewArrayOf,
+        BlockStmt, IfElse, WhileLoop, ForLoop, BreakLoop, ReturnValue, PrintArgs,
+        NumKinds
+    } Kind;
+    static const int None = -1;   // no node, e.g. no else part
+
+    FlatTree();
+
+          // Building, each returning the index of the node added. The
+          // operator is given as in the source ("+", "<=") and left is
+          // None for a unary one.
+    int Empty();
+    int Constant(Kind kind, yyltype loc, int value);   // an int, bool or null
+    int String(yyltype loc, const char *value);
+    int Leaf(Kind kind, yyltype loc);                  // this, ReadInteger(), ...
+    int Operation(yyltype opLoc, const char *op, int left, int right);
+    int Field(int base, yyltype fieldLoc, const char *field);  // base may be None
+    int Index(yyltype loc, int base, int subscript);
+    int Call(yyltype loc, int base, yyltype fieldLoc, const char *field, List<int> *actuals);
+    int New(yyltype loc, yyltype classLoc, const char *className);
+    int NewArray(yyltype loc, int size, Type *elemType);
+    int Block(List<VarDecl*> *decls, List<int> *stmts);
+    int If(int test, int thenBody, int elseBody);       // elseBody may be None
+    int While(int test, int body);
+    int For(int init, int test, int step, int body);
+    int Break(yyltype loc);
+    int Return(yyltype loc, int expr);
+    int Print(List<int> *args);
+
+          // The passes over the body of fn, block being its root
+    void Bind(FnDecl *fn, int block, ScopeStack *scopes);
+    void Check(FnDecl *fn, int block);
+    void Emit(FnDecl *fn, int block, CodeGenerator *cg);
+
+  private:
+    struct Name {
+        const char *name;     // interned
+        int location;
+        Decl *decl;           // what it names, once known
+        bool implicitThis;    // a field or method of this, with no base written
+    };
+
+    std::vector<unsigned char> kind;
+    std::vector<int> location;      // in the table of ast.h, None if none
+    std::vector<int> type;          // in types, None until checked
+    std::vector<int> value;         // see AddNode
+    std::vector<int> firstKid;
+    std::vector<int> kids;
+
+    std::vector<Type*> types;
+    std::unordered_map<Type*, int> typeIds;
+    std::vector<Name> names;
+    std::vector<const char*> strings;
+    std::vector<Type*> elemTypes;            // of NewArray, canonical once bound
+    std::vector<List<VarDecl*>*> blockDecls;
+
+          // The function being worked on and where in it we are
+    FnDecl *fn;
+    ClassDecl *enclosingClass;
+    ScopeStack *scopes;
+    CodeGenerator *cg;
+    int loopDepth;
+    const char *loopExit;
+
+    int AddNode(Kind k, int loc, int value);
+    int AddName(yyltype loc, const char *name);
+    int Kid(int n, int i) const        { return kids[firstKid[n] + i]; }
+    int NumKids(int n) const;
+    yyltype *LocationOf(int n);
+    Type *TypeOf(int n)                { return types[type[n]]; }
+    void SetType(int n, Type *t);
+    Decl *FieldDecl(Name& name, Type *baseType);
+    Type *ThisType(yyltype *loc);
+
+    void BindNode(int n);
+    void CheckStmt(int n);
+    Type *CheckExpr(int n);
+    Type *ComputeType(int n);
+    void CheckTest(int test);
+    void EmitStmt(int n);
+    Location *EmitExpr(int n);
+    Location *EmitLValue(int n);
+    void ReportIncompatible(int n, Type *lhs, Type *rhs);
+
+    FlatTree(const FlatTree&);      // not copyable
+    void operator=(const FlatTree&);
+};
+
+#endif
@@ -1,22 +1,65 @@
 /* File: hashtable.cc
  * ------------------
- * Implementation of Hashtable class.
+ * Implementation of Hashtable class. Each key has one slot, holding
+ * the value entered last, found by linear probing from the key's home
+ * slot. Values it shadows wait in a side list (shadowing is rare) and
+ * move back into the slot if it is removed.
  */
-   
+
+#include <algorithm>
+#include <string.h>
+
+
+/* Hashtable::Home, Hashtable::SlotFor
+ * -----------------------------------
+ * Home is where probing for key starts. Symbol ids are dense, so a
+ * multiplicative hash of the id spreads them over the slots. SlotFor
+ * returns key's slot, or the empty slot where it would go.
+ */
+template <class Value> int Hashtable<Value>::Home(const char *key) const
+{
+  return ((unsigned)SymbolId(key) * 2654435769u) & (slots.size() - 1);
+}
+
+template <class Value> int Hashtable<Value>::SlotFor(const char *key) const
+{
+  int mask = slots.size() - 1;
+  int i = Home(key);
+  while (slots[i].key && slots[i].key != key)
+    i = (i + 1) & mask;
+  return i;
+}
+
 
 /* Hashtable::Enter
  * ----------------
  * Stores new value for given identifier. If the key already
  * has an entry and flag is to overwrite, will remove previous entry first,
- * otherwise it just adds another entry under same key. Copies the
- * key, so you don't have to worry about its allocation.
+ * otherwise it just adds another entry under same key. The key must
+ * be interned, so it isn't copied.
  */
 template <class Value> void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite)
 {
-  Value prev;
-  if (overwrite && (prev = Lookup(key)))
-    Remove(key, prev);
-  mmap.insert(std::make_pair(strdup(key), val));
+  int i = SlotFor(key);
+  Entry e = { key, val, nextSeq++ };
+  if (slots[i].key) {
+    if (!overwrite)
+      shadowed.push_back(slots[i]);
+    slots[i] = e;
+    return;
+  }
+  slots[i] = e;
+  if (2 * ++numKeys > (int)slots.size())
+    Grow();
+}
+
+template <class Value> void Hashtable<Value>::Grow()
+{
+  std::vector<Entry> old(2 * slots.size());
+  old.swap(slots);
+  for (int j = 0; j < (int)old.size(); j++)
+    if (old[j].key)
+      slots[SlotFor(old[j].key)] = old[j];
 }
 
  
@@ -24,23 +67,53 @@ template <class Value> void Hashtable<Value>::Enter(const char *key, Value val,
  * -----------------
  * Removes a given key-value pair from table. If no such pair, no
  * changes are made.  Does not affect any other entries under that key.
+ * Like before, the earliest entered matching pair is the one removed.
  */
 template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
 {
-  if (mmap.count(key) == 0) // no matches at all
+  int i = SlotFor(key);
+  if (!slots[i].key) // no matches at all
     return;
 
-  typename std::multimap<const char *, Value>::iterator itr;
-  itr = mmap.find(key); // start at first occurrence
-  while (itr != mmap.upper_bound(key)) {
-    if (itr->second == val) { // iterate to find matching pair
-	mmap.erase(itr);
-	break;
+  for (int j = 0; j < (int)shadowed.size(); j++) {
+    if (shadowed[j].key == key && shadowed[j].value == val) {
+      shadowed.erase(shadowed.begin() + j);
+      return;
     }
-    ++itr;
   }
+  if (slots[i].value != val)
+    return;
+
+  int latest = -1; // the value it shadowed last comes back
+  for (int j = 0; j < (int)shadowed.size(); j++)
+    if (shadowed[j].key == key)
+      latest = j;
+  if (latest != -1) {
+    slots[i] = shadowed[latest];
+    shadowed.erase(shadowed.begin() + latest);
+  } else
+    Vacate(i);
 } 
 
+/* Hashtable::Vacate
+ * -----------------
+ * Empties a slot, moving later entries of its probe run back so that
+ * every key can still be reached from its home without a gap.
+ */
+template <class Value> void Hashtable<Value>::Vacate(int hole)
+{
+  int mask = slots.size() - 1;
+  for (int j = (hole + 1) & mask; slots[j].key; j = (j + 1) & mask) {
+    int home = Home(slots[j].key);
+    if (((j - home) & mask) >= ((j - hole) & mask)) { // home not in (hole, j]
+      slots[hole] = slots[j];
+      hole = j;
+    }
+  }
+  slots[hole].key = NULL;
+  numKeys--;
+}
+
 
 /* Hashtable::Lookup
  * -----------------
@@ -49,21 +122,8 @@ template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
  */
 template <class Value> Value Hashtable<Value>::Lookup(const char *key) 
 {
-  Value found = NULL;
-  
-  if (mmap.count(key) > 0) {
-    typename std::multimap<const char *, Value>::iterator cur, last, prev;
-    cur = mmap.find(key); // start at first occurrence
-    last = mmap.upper_bound(key);
-    while (cur != last) { // iterate to find last entered
-	prev = cur; 
-	if (++cur == mmap.upper_bound(key)) { // have to go one too far
-	  found = prev->second; // one before last was it
-	  break;
-	}
-    }
-  }
-  return found;
+  const Entry& e = slots[SlotFor(key)];
+  return e.key ? e.value : NULL;
 }
 
 
@@ -72,7 +132,7 @@ template <class Value> Value Hashtable<Value>::Lookup(const char *key)
  */
 template <class Value> int Hashtable<Value>::NumEntries() const
 {
-  return mmap.size();
+  return numKeys + shadowed.size();
 }
 
 
@@ -80,10 +140,27 @@ template <class Value> int Hashtable<Value>::NumEntries() const
 /* Hashtable:GetIterator
  * ---------------------
  * Returns iterator which can be used to walk through all values in table.
+ * The values are gathered and sorted up front: by key, alphabetically,
+ * and in the order they were entered under the same key.
  */
+template <class Value> bool Hashtable<Value>::VisitsBefore(const Entry& a, const Entry& b)
+{
+  int cmp = (a.key == b.key) ? 0 : strcmp(a.key, b.key);
+  return cmp < 0 || (cmp == 0 && a.seq < b.seq);
+}
+
 template <class Value> Iterator<Value> Hashtable<Value>::GetIterator() 
 {
-  return Iterator<Value>(mmap);
+  std::vector<Entry> all(shadowed);
+  for (int i = 0; i < (int)slots.size(); i++)
+    if (slots[i].key)
+      all.push_back(slots[i]);
+  std::sort(all.begin(), all.end(), VisitsBefore);
+
+  Iterator<Value> iter;
+  for (int i = 0; i < (int)all.size(); i++)
+    iter.values.push_back(all[i].value);
+  return iter;
 }
 
 
@@ -94,6 +171,5 @@ template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
  */
 template <class Value> Value Iterator<Value>::GetNextValue()
 {
-  return (cur == end ? NULL : (*cur++).second);
+  return (cur == (int)values.size() ? NULL : values[cur++]);
 }
-
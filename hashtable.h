@@ -1,10 +1,10 @@
 /* File: hashtable.h
  * -----------------
  * This is a simple table for storing values associated with a string
- * key, supporting simple operations for Enter and Lookup.  It is not
- * much more than a thin cover over the STL associative map container,
- * but hides the awkward C++ template syntax and provides a more
- * familiar interface.
+ * key, supporting simple operations for Enter and Lookup.  The keys
+ * must be interned (see intern.h): the table is open-addressed on
+ * the key's symbol id and compares keys by address, so a Lookup is
+ * a hash and usually a single probe, with no strcmp at all.
  *
  * The keys are always strings, but the values can be of any type
  * (ok, that's actually kind of a fib, it expects the type to be
@@ -29,17 +29,11 @@
  *          }
  *       }
  */
-
 #ifndef _H_hashtable
 #define _H_hashtable
 
-#include <map>
-#include <string.h>
-
-struct ltstr {
-  bool operator()(const char* s1, const char* s2) const
-  { return strcmp(s1, s2) < 0; }
-};
+#include <vector>
+#include "intern.h"
 
 
 template <class Value> class Iterator;
@@ -47,11 +41,24 @@ template <class Value> class Iterator;
 template<class Value> class Hashtable {
 
   private: 
-     std::multimap<const char*, Value, ltstr> mmap;
+     struct Entry {
+         const char *key;   // NULL in an empty slot
+         Value value;
+         int seq;           // order of entry, for shadowing and iteration
+     };
+     std::vector<Entry> slots;    // latest value per key, size a power of 2
+     std::vector<Entry> shadowed; // earlier values still under some key
+     int numKeys, nextSeq;
+
+     int Home(const char *key) const;
+     int SlotFor(const char *key) const;
+     void Grow();
+     void Vacate(int slot);
+     static bool VisitsBefore(const Entry& a, const Entry& b);
  
    public:
             // ctor creates a new empty hashtable
-     Hashtable() {}
+     Hashtable() : slots(8), numKeys(0), nextSeq(0) {}
 
            // Returns number of entries currently in table
      int NumEntries() const;
@@ -91,9 +98,9 @@ template<class Value> class Iterator {
   friend class Hashtable<Value>;
 
   private:
-    typename std::multimap<const char*, Value , ltstr>::iterator cur, end;
-    Iterator(std::multimap<const char*, Value, ltstr>& t)
-      : cur(t.begin()), end(t.end()) {}
+    std::vector<Value> values; // in visiting order
+    int cur;
+    Iterator() : cur(0) {}
 
   public:
          // Returns current value and advances iterator to next.
@@ -0,0 +1,107 @@
+/* File: intern.cc
+ * ---------------
+ * The intern tables are open-addressed with linear probing and kept at
+ * most half full. Each string is stored in an arena just after its
+ * int id, which is how SymbolId finds the id without a lookup.
+ */
+
+#include "intern.h"
+#include <atomic>
+#include <string.h>
+#include "compilation.h"
+#include "utility.h"
+
+  // Set once the first compilation starts: the shared table must not
+  // change after that, as compilations read it without a lock
+static std::atomic<bool> sharedFrozen(false);
+
+// FNV-1a
+static unsigned Hash(const char *s, size_t *length)
+{
+    unsigned h = 2166136261u;
+    const char *p = s;
+    for (; *p; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    *length = p - s;
+    return h;
+}
+
+InternTable::InternTable(const InternTable *shared)
+  : slots(1024), shared(shared), firstId(shared ? shared->NumSymbols() : 0), count(0) {}
+
+InternTable::InternTable() : slots(1024), count(0)
+{
+    shared = &Shared();
+    sharedFrozen = true;
+    firstId = shared->NumSymbols();
+}
+
+// made on first use, so names can be interned during static init
+InternTable& InternTable::Shared()
+{
+    static InternTable table(NULL);
+    return table;
+}
+
+/* Method: Find
+ * ------------
+ * Returns the stored copy of s, or NULL with *slot set to the empty
+ * slot where it would go.
+ */
+const char *InternTable::Find(const char *s, unsigned h, unsigned *slot) const
+{
+    unsigned mask = slots.size() - 1;
+    unsigned i = h & mask;
+    for (; slots[i].str; i = (i + 1) & mask)
+        if (slots[i].hash == h && !strcmp(slots[i].str, s))
+            return slots[i].str;
+    *slot = i;
+    return NULL;
+}
+
+const char *InternTable::Intern(const char *s)
+{
+    size_t len;
+    unsigned h = Hash(s, &len), i;
+    const char *found = shared ? shared->Find(s, h, &i) : NULL;
+    if (!found) found = Find(s, h, &i);
+    if (found) return found;
+
+    char *mem = (char *)strings.Allocate(sizeof(int) + len + 1);
+    *(int *)mem = firstId + count++;
+    char *copy = (char *)memcpy(mem + sizeof(int), s, len + 1);
+    slots[i].hash = h;
+    slots[i].str = copy;
+    if (2*count > (int)slots.size())
+        Grow();
+    return copy;
+}
+
+void InternTable::Grow()
+{
+    std::vector<Slot> old(2*slots.size());
+    old.swap(slots);
+    unsigned mask = slots.size() - 1;
+    for (size_t j = 0; j < old.size(); j++) {
+        if (!old[j].str) continue;
+        unsigned i = old[j].hash & mask;
+        while (slots[i].str)
+            i = (i + 1) & mask;
+        slots[i] = old[j];
+    }
+}
+
+
+const char *Intern(const char *s)
+{
+    Compilation *c = Compilation::Current();
+    if (c) return c->Names()->Intern(s);
+    Assert(!sharedFrozen);
+    return InternTable::Shared().Intern(s);
+}
+
+int NumSymbols()
+{
+    Compilation *c = Compilation::Current();
+    return c ? c->Names()->NumSymbols() : InternTable::Shared().NumSymbols();
+}
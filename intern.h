@@ -0,0 +1,67 @@
+/* File: intern.h
+ * --------------
+ * The table of names: identifiers, type names, function and branch
+ * labels, variable names. Intern returns the one stored copy of a
+ * string, so two interned strings are equal exactly when their
+ * pointers are, and names are compared with == rather than strcmp.
+ *
+ * Each compilation has a table of its own (see compilation.h), and
+ * the names interned while it runs go when it ends. The few names
+ * interned before any compilation starts (by static initializers:
+ * the built-in type names, "this") are in a shared table that every
+ * compilation searches first and none changes, so compilations on
+ * different threads never touch each other's names. Only the thread
+ * running a compilation interns for it.
+ *
+ * Every interned string also has a dense id, for tables indexed by
+ * name: the shared names are 0, 1, 2, ... and a compilation's own
+ * carry on from there in order of first interning.
+ *
+ *   const char *main = Intern("main");
+ *   if (decl->GetName() == main) ...
+ */
+
+#ifndef _H_intern
+#define _H_intern
+
+#include <vector>
+#include "arena.h"
+
+const char *Intern(const char *s);
+
+     // The id of a string returned by Intern (only those!)
+inline int SymbolId(const char *interned) { return ((const int *)interned)[-1]; }
+
+int NumSymbols();
+
+
+class InternTable
+{
+  public:
+    InternTable();      // a compilation's, on top of the shared names
+    const char *Intern(const char *s);
+    int NumSymbols() const { return firstId + count; }
+
+  private:
+    struct Slot {
+        unsigned hash;
+        const char *str;    // NULL if empty
+    };
+    std::vector<Slot> slots;  // size is a power of 2
+    const InternTable *shared; // searched first, NULL in the shared table
+    int firstId, count;
+    Arena strings;
+
+    InternTable(const InternTable *shared);
+    const char *Find(const char *s, unsigned hash, unsigned *slot) const;
+    void Grow();
+
+    static InternTable& Shared();
+    friend const char *Intern(const char *s);
+    friend int NumSymbols();
+
+    InternTable(const InternTable&);   // not copyable
+    void operator=(const InternTable&);
+};
+
+#endif
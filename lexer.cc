@@ -0,0 +1,384 @@
+/* File: lexer.cc
+ * --------------
+ * A hand-written scanner, an alternative to the flex one in scanner.l
+ * (build with "make SCANNER=hand"). It has the same interface (see
+ * scanner.h), returns the same tokens, reports the same errors and
+ * fills in yylloc exactly as scanner.l does, so the two can be swapped
+ * without any change in what the compiler prints.
+ *
+ * It is faster because it doesn't run a table-driven automaton over
+ * every char: it switches on the first char of a lexeme, scans runs of
+ * spaces, identifier chars and comment and string text 16 bytes at a
+ * time with SSE2 where that is available, and looks keywords up in a
+ * perfect hash table rather than matching them as 22 separate rules.
+ *
+ * Like flex, it ends each token's text (yytext here, too) by writing a
+ * nul over the char after it in the source, and puts the char back
+ * when it moves on, so the text is passed on without being copied.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "scanner.h"
+#include "utility.h" // for PrintDebug()
+#include "errors.h"
+#include "parser.h" // for token codes, yylval
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TAB_SIZE 8
+
+/* Struct: Lexer
+ * -------------
+ * A scanner, as handed out by InitScanner: the source and where it is
+ * in it, and the char written over to end the last token's text.
+ */
+struct Lexer {
+    char *text;
+    int length;
+    int pos;                    // offset of the next char to scan
+    int curLineNum, curColNum;
+    char *held;                 // where yytext's nul is, NULL if none
+    char heldChar;              // and what was there
+};
+
+
+/* Function: IsIdentChar
+ * ---------------------
+ * Whether c can continue an identifier, and the same test on 16 chars
+ * at once (bit i of the result is set if char i can). The other tests
+ * are the ranges the flex rules use (no locale, no sign trouble).
+ */
+static inline bool IsLetter(char c)   { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static inline bool IsDigit(char c)    { return c >= '0' && c <= '9'; }
+static inline bool IsHexDigit(char c) { return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+static inline bool IsIdentChar(char c) { return IsLetter(c) || IsDigit(c) || c == '_'; }
+
+#ifdef __SSE2__
+static inline int IdentChars(__m128i v)
+{
+    // chars 0x80 and up are negative as signed bytes, so none of the
+    // ranges (all in ASCII) take them in
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), under));
+}
+#endif
+
+/* Function: SpanIdent, SpanSpaces, FindAny
+ * ----------------------------------------
+ * The lengths of the run of identifier chars and of spaces at p, and
+ * the first of the chars a, b and c at or after p (end if none). None
+ * of them reads at or past end.
+ */
+static int SpanIdent(const char *p, const char *end)
+{
+    const char *s = p;
+    for (const char *short_ = s + 8; s < short_; s++)  // most runs are short
+        if (s == end || !IsIdentChar(*s)) return s - p;
+#ifdef __SSE2__
+    for (; end - s >= 16; s += 16) {
+        int stop = ~IdentChars(_mm_loadu_si128((const __m128i *)s)) & 0xFFFF;
+        if (stop) return s - p + __builtin_ctz(stop);
+    }
+#endif
+    while (s < end && IsIdentChar(*s)) s++;
+    return s - p;
+}
+
+static int SpanSpaces(const char *p, const char *end)
+{
+    const char *s = p;
+    for (const char *short_ = s + 4; s < short_; s++)
+        if (s == end || *s != ' ') return s - p;
+#ifdef __SSE2__
+    for (; end - s >= 16; s += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)s);
+        int stop = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' '))) & 0xFFFF;
+        if (stop) return s - p + __builtin_ctz(stop);
+    }
+#endif
+    while (s < end && *s == ' ') s++;
+    return s - p;
+}
+
+static const char *FindAny(const char *p, const char *end, char a, char b, char c)
+{
+#ifdef __SSE2__
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(a)),
+                                                _mm_cmpeq_epi8(v, _mm_set1_epi8(b))),
+                                   _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+        int found = _mm_movemask_epi8(hit);
+        if (found) return p + __builtin_ctz(found);
+    }
+#endif
+    while (p < end && *p != a && *p != b && *p != c) p++;
+    return p;
+}
+
+
+/* Class: KeywordTable
+ * -------------------
+ * The keywords (and true and false), hashed on their length and first
+ * and last chars. The hash is perfect for this set: every word has a
+ * slot of its own, so a lookup is one hash and one compare. The table
+ * checks that when it is built, should a keyword ever be added.
+ */
+class KeywordTable
+{
+  public:
+    KeywordTable();
+    int Lookup(const char *word, int len) const; // token code, 0 if not a keyword
+
+  private:
+    static const int NumSlots = 64;
+    struct Slot { const char *word; int len, token; };
+    Slot slots[NumSlots];
+
+    static int Hash(const char *word, int len)
+        { return (word[0] + 5*word[len-1] + 13*len) & (NumSlots - 1); }
+};
+
+static const struct { const char *word; int token; } keywords[] = {
+    {"void", T_Void}, {"int", T_Int}, {"double", T_Double}, {"bool", T_Bool},
+    {"string", T_String}, {"null", T_Null}, {"class", T_Class},
+    {"extends", T_Extends}, {"this", T_This}, {"interface", T_Interface},
+    {"implements", T_Implements}, {"while", T_While}, {"for", T_For},
+    {"if", T_If}, {"else", T_Else}, {"return", T_Return}, {"break", T_Break},
+    {"New", T_New}, {"NewArray", T_NewArray}, {"Print", T_Print},
+    {"ReadInteger", T_ReadInteger}, {"ReadLine", T_ReadLine},
+    {"true", T_BoolConstant}, {"false", T_BoolConstant},
+};
+
+KeywordTable::KeywordTable()
+{
+    memset(slots, 0, sizeof(slots));
+    for (int i = 0; i < sizeof(keywords)/sizeof(keywords[0]); i++) {
+        int len = strlen(keywords[i].word);
+        Slot *s = &slots[Hash(keywords[i].word, len)];
+        Assert(s->word == NULL); // else the hash isn't perfect any more
+        s->word = keywords[i].word;
+        s->len = len;
+        s->token = keywords[i].token;
+    }
+}
+
+int KeywordTable::Lookup(const char *word, int len) const
+{
+    const Slot *s = &slots[Hash(word, len)];
+    return (s->len == len && memcmp(s->word, word, len) == 0) ? s->token : 0;
+}
+
+
+/* Function: Match
+ * ---------------
+ * Takes the next len chars as a lexeme, the way scanner.l's
+ * DoBeforeEachAction does: yylloc gets where it is and the column
+ * moves past it. MatchEach takes them one at a time (as a comment's
+ * text is), which leaves yylloc on the last of them.
+ */
+static char *Match(Lexer *lex, yyltype *loc, int len)
+{
+    char *start = lex->text + lex->pos;
+    loc->first_line = lex->curLineNum;
+    loc->first_column = lex->curColNum;
+    loc->last_column = lex->curColNum + len - 1;
+    lex->curColNum += len;
+    lex->pos += len;
+    return start;
+}
+
+static void MatchEach(Lexer *lex, yyltype *loc, int len)
+{
+    lex->curColNum += len - 1;
+    lex->pos += len - 1;
+    Match(lex, loc, 1);
+}
+
+static void MatchNewline(Lexer *lex, yyltype *loc)
+{
+    Match(lex, loc, 1);
+    lex->curLineNum++;
+    lex->curColNum = 1;
+}
+
+static void MatchTab(Lexer *lex, yyltype *loc)
+{
+    Match(lex, loc, 1);
+    lex->curColNum += TAB_SIZE - lex->curColNum%TAB_SIZE + 1;
+}
+
+/* Function: MatchToken
+ * --------------------
+ * Match for a lexeme whose text is wanted: it is ended with a nul
+ * until the scanner moves on.
+ */
+static char *MatchToken(Lexer *lex, yyltype *loc, int len)
+{
+    char *yytext = Match(lex, loc, len);
+    lex->held = yytext + len;
+    lex->heldChar = *lex->held;
+    *lex->held = '\0';
+    return yytext;
+}
+
+
+void *InitScanner(char *source, int length)
+{
+    PrintDebug("lex", "Initializing scanner");
+    Lexer *lex = new Lexer;
+    lex->text = source;
+    lex->length = length;
+    lex->pos = 0;
+    lex->curLineNum = 1;
+    lex->curColNum = 1;
+    lex->held = NULL;
+    return lex;
+}
+
+void FreeScanner(void *scanner)
+{
+    RestoreSource(scanner);
+    delete (Lexer *)scanner;
+}
+
+void RestoreSource(void *scanner)
+{
+    Lexer *lex = (Lexer *)scanner;
+    if (lex->held) *lex->held = lex->heldChar;
+}
+
+void TerminateToken(void *scanner)
+{
+    Lexer *lex = (Lexer *)scanner;
+    if (lex->held) *lex->held = '\0';
+}
+
+
+/* Function: ScanComment
+ * ---------------------
+ * Scans the rest of a block comment. Returns false if the input ends
+ * before the comment does.
+ */
+static bool ScanComment(Lexer *lex, yyltype *loc)
+{
+    const char *end = lex->text + lex->length;
+    for (;;) {
+        const char *p = lex->text + lex->pos;
+        const char *stop = FindAny(p, end, '*', '\n', '\t');
+        if (stop > p) MatchEach(lex, loc, stop - p);
+        if (stop == end) return false;
+        if (*stop == '\n') MatchNewline(lex, loc);
+        else if (*stop == '\t') MatchTab(lex, loc);
+        else if (stop[1] == '/') { Match(lex, loc, 2); return true; }
+        else Match(lex, loc, 1);
+    }
+}
+
+/* Function: ScanNumber
+ * --------------------
+ * Scans the longest integer, hex integer or double at p, as the flex
+ * rules would, and returns its token.
+ */
+static int ScanNumber(Lexer *lex, YYSTYPE *yylval, yyltype *loc, const char *p)
+{
+    int len = 1;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && IsHexDigit(p[2])) {
+        for (len = 3; IsHexDigit(p[len]); len++) ;
+        yylval->integerConstant = strtol(MatchToken(lex, loc, len), NULL, 16);
+        return T_IntConstant;
+    }
+    while (IsDigit(p[len])) len++;
+    if (p[len] != '.') {
+        yylval->integerConstant = strtol(MatchToken(lex, loc, len), NULL, 10);
+        return T_IntConstant;
+    }
+    for (len++; IsDigit(p[len]); len++) ;
+    if (p[len] == 'E' || p[len] == 'e') {
+        int sign = (p[len+1] == '+' || p[len+1] == '-');
+        if (IsDigit(p[len+1+sign]))
+            for (len += 1 + sign; IsDigit(p[len]); len++) ;
+    }
+    yylval->doubleConstant = atof(MatchToken(lex, loc, len));
+    return T_DoubleConstant;
+}
+
+/* Function: yylex
+ * ---------------
+ * Returns the next token, skipping spaces and comments and reporting
+ * anything that isn't a token. The source is followed by two nuls, so
+ * looking a couple of chars ahead never goes past the end of it.
+ */
+int yylex(YYSTYPE *yylval, yyltype *yylloc, void *scanner)
+{
+    static const KeywordTable keywordTable;
+    static const char twoCharOps[][2] = {{'<','='}, {'>','='}, {'=','='}, {'!','='},
+                                         {'&','&'}, {'|','|'}, {'[',']'}};
+    static const int twoCharTokens[] = {T_LessEqual, T_GreaterEqual, T_Equal, T_NotEqual,
+                                        T_And, T_Or, T_Dims};
+
+    Lexer *lex = (Lexer *)scanner;
+    const char *end = lex->text + lex->length;
+
+    for (;;) {
+        RestoreSource(lex);  // the last token's text is done with
+        lex->held = NULL;
+        const char *p = lex->text + lex->pos;
+        if (p == end) return 0;
+        char c = *p;
+
+        if (c == '\n') {
+            MatchNewline(lex, yylloc);
+        } else if (c == ' ') {
+            Match(lex, yylloc, SpanSpaces(p, end));
+        } else if (c == '\t') {
+            MatchTab(lex, yylloc);
+        } else if (c == '/' && p[1] == '*') {
+            Match(lex, yylloc, 2);
+            if (!ScanComment(lex, yylloc)) {
+                ReportError::UntermComment();
+                return 0;
+            }
+        } else if (c == '/' && p[1] == '/') {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            Match(lex, yylloc, (eol ? eol : end) - p);
+        } else if (IsLetter(c)) {
+            int len = SpanIdent(p, end);
+            char *yytext = MatchToken(lex, yylloc, len);
+            int token = keywordTable.Lookup(yytext, len);
+            if (token == T_BoolConstant) yylval->boolConstant = (yytext[0] == 't');
+            if (token) return token;
+            if (len > MaxIdentLen)
+                ReportError::LongIdentifier(yylloc, yytext);
+            strncpy(yylval->identifier, yytext, MaxIdentLen);
+            yylval->identifier[MaxIdentLen] = '\0';
+            return T_Identifier;
+        } else if (IsDigit(c)) {
+            return ScanNumber(lex, yylval, yylloc, p);
+        } else if (c == '"') {
+            const char *close = FindAny(p + 1, end, '"', '\n', '"');
+            if (close < end && *close == '"') {
+                yylval->stringConstant = Node::CopyString(MatchToken(lex, yylloc, close + 1 - p));
+                return T_StringConstant;
+            }
+            ReportError::UntermString(yylloc, MatchToken(lex, yylloc, close - p));
+        } else {
+            for (int i = 0; i < sizeof(twoCharTokens)/sizeof(twoCharTokens[0]); i++)
+                if (c == twoCharOps[i][0] && p[1] == twoCharOps[i][1]) {
+                    MatchToken(lex, yylloc, 2);
+                    return twoCharTokens[i];
+                }
+            MatchToken(lex, yylloc, 1);
+            if (c != '\0' && strchr("-+/*%=.,;!<>()[]{}", c)) return c;
+            ReportError::UnrecogChar(yylloc, c);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/* File: libdecaf.h
+ * ----------------
+ * The compiler as a library: hand it the text of a Decaf program and
+ * the options you would give dcc on the command line, and get back the
+ * MIPS assembly and the error messages as strings. Nothing is read from
+ * stdin or written to stdout/stderr, and nothing is left behind, so a
+ * long-lived process can compile any number of programs, one after
+ * another or side by side.
+ *
+ *   DecafOptions options;
+ *   options.optLevel = 2;
+ *   DecafResult result = CompileDecaf(text, strlen(text), options);
+ *   if (result.numErrors == 0) Save(result.assembly);
+ *   else Show(result.diagnostics);
+ *
+ * Any number of compilations can run at once, each on its own thread:
+ * everything a compilation uses, down to its table of interned names,
+ * is its own and goes when it returns (see compilation.h). An internal
+ * compiler error still reports through Failure, which aborts the
+ * process.
+ */
+
+#ifndef _H_libdecaf
+#define _H_libdecaf
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct DecafOptions {
+    int optLevel;                        // as -O<level>
+    bool leanAsm;                        // as --lean-asm
+    int numThreads;                      // as -j<n>, 0 for one per core
+    std::string cacheDir;                // as --cache-dir=<dir>, "" for none
+    bool timeReport;                     // as --time-report, written with the diagnostics
+    bool flatAst;                        // as --flat-ast, function bodies built as a
+                                         //  FlatTree instead of nodes (see flatast.h)
+    std::string traceFile;               // as --trace=<file>, "" for none
+    std::vector<std::string> debugKeys;  // as -d <key> ... ("tac" gives TAC, not MIPS,
+                                         //  "tokens" the tokens and "scan" just their
+                                         //  number, see parser.y)
+
+    DecafOptions() : optLevel(0), leanAsm(false), numThreads(0), timeReport(false),
+                     flatAst(false) {}
+};
+
+struct DecafResult {
+    std::string assembly;     // what dcc writes to stdout (no code if there were errors)
+    std::string diagnostics;  // what dcc writes to stderr: the error messages
+    int numErrors;
+    int cacheHits, cacheMisses;  // functions found and not found in the cache
+};
+
+DecafResult CompileDecaf(const char *source, size_t length, const DecafOptions& options);
+
+#endif
@@ -2,15 +2,22 @@
  * ------------
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
- * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
+ * append, remove, etc., with some added range-checking. Given not everyone
  * is familiar with the C++ templates, this class provides a more familiar
  * interface.
  *
- * It can handle elements of any type, the typename for a List includes the
- * element type in angle brackets, e.g.  to store elements of type double,
- * you would use the type name List<double>, to store elements of type
- * Decl *, it woud be List<Decl*> and so on.
+ * The elements are kept in one array. The first few live inside the List
+ * itself, so the many short lists in the tree (formals, actuals, members)
+ * need no storage of their own, and a longer list moves to a bigger array
+ * as it grows. A list made while Node::arena is set (see ast.h) grows in
+ * that arena, and if made with new is allocated there too, so the tree's
+ * lists go away with the tree. Other lists grow on the heap.
+ *
+ * It can handle elements of any small value type (they are copied with =),
+ * the typename for a List includes the element type in angle brackets,
+ * e.g.  to store elements of type double, you would use the type name
+ * List<double>, to store elements of type Decl *, it woud be List<Decl*>
+ * and so on.
  *
  * Here is some sample code illustrating the usage of a List of integers
  *
@@ -28,25 +35,39 @@
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
 #include "utility.h"  // for Assert()
 #include "scope.h"
+#include "ast.h"      // for Node::arena
   
-class Node;
 class CodeGenerator;
 
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    static const int InlineCapacity = 4;
+    Element *elems;      // inlineElems until the list outgrows them
+    int count, capacity;
+    Arena *arena;        // storage comes from here if set, else the heap
+    Element inlineElems[InlineCapacity];
+
+    void Reserve(int needed);
 
  public:
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), count(0), capacity(InlineCapacity),
+             arena(Node::arena) {}
+    List(const List &other);
+    List &operator=(const List &other);
+    ~List()
+        { if (elems != inlineElems && !arena) delete[] elems; }
+
+    void *operator new(size_t size)
+        { return Node::arena ? Node::arena->Allocate(size) : ::operator new(size); }
+    void operator delete(void *p) {} // like nodes, never freed one by one
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return count; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
@@ -58,17 +79,22 @@ template<class Element> class List {
           // Raises assert if index out of range
     void InsertAt(const Element &elem, int index)
 	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	  Element copy = elem; // elem may be in the array about to move
+	  if (count == capacity) Reserve(count + 1);
+	  for (int i = count; i > index; i--) elems[i] = elems[i-1];
+	  elems[index] = copy;
+	  count++; }
 
           // Adds element to list end
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ InsertAt(elem, count); }
 
          // Removes element at index, shuffling down others
          // Raises assert if index out of range
     void RemoveAt(int index)
 	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	  for (int i = index; i < count - 1; i++) elems[i] = elems[i+1];
+	  count--; }
           
        // These are some specific methods useful for lists of ast nodes
        // They will only work on lists of elements that respond to the
@@ -82,6 +108,9 @@ template<class Element> class List {
         { for (int i = 0; i < NumElements(); i++)
              s->Declare(Nth(i)); }
 
+    void BindAll(ScopeStack *s)
+        { for (int i = 0; i < NumElements(); i++)
+             Nth(i)->Bind(s); }
    void CheckAll()
         { for (int i = 0; i < NumElements(); i++)
              Nth(i)->Check(); }
@@ -91,5 +120,39 @@ template<class Element> class List {
 
 };
 
+
+template<class Element> List<Element>::List(const List &other)
+  : elems(inlineElems), count(0), capacity(InlineCapacity), arena(Node::arena)
+{
+    *this = other;
+}
+
+template<class Element> List<Element> &List<Element>::operator=(const List &other)
+{
+    if (this == &other) return *this;
+    if (other.count > capacity) Reserve(other.count);
+    for (int i = 0; i < other.count; i++) elems[i] = other.elems[i];
+    count = other.count;
+    return *this;
+}
+
+/* Method: Reserve
+ * ---------------
+ * Moves the elements to an array with room for at least needed, doubling
+ * the capacity so appending stays amortized constant time. An outgrown
+ * arena array is just left behind.
+ */
+template<class Element> void List<Element>::Reserve(int needed)
+{
+    int newCapacity = 2 * capacity;
+    if (newCapacity < needed) newCapacity = needed;
+    Element *bigger = arena ? (Element *)arena->Allocate(newCapacity * sizeof(Element))
+                            : new Element[newCapacity];
+    for (int i = 0; i < count; i++) bigger[i] = elems[i];
+    if (elems != inlineElems && !arena) delete[] elems;
+    elems = bigger;
+    capacity = newCapacity;
+}
+
 #endif
 
@@ -0,0 +1,64 @@
+/* File: liveness.cc
+ * -----------------
+ * Variable numbering plus the transfer and meet functions for live
+ * variable analysis.
+ */
+
+#include "liveness.h"
+#include "tac.h"
+
+/* Method: Liveness
+ * ----------------
+ * Numbers the vars in order of first appearance and records each
+ * instruction's kill and gen, then runs the analysis.
+ */
+Liveness::Liveness(ControlFlowGraph& cfg)
+  : DataFlow<LiveSet, ControlFlowGraph::ReverseFlow>(cfg)
+{
+    transfer.resize(cfg.num_instrs());
+    for (int j = 0; j < cfg.num_instrs(); j++) {
+        Instruction *instr = cfg.instr(j);
+        Transfer& t = transfer[j];
+        Location *uses[3];
+        t.numGen = instr->GetUses(uses);
+        for (int i = 0; i < t.numGen; i++)
+            t.gen[i] = Number(uses[i]);
+        t.kill = instr->GetDef() ? Number(instr->GetDef()) : -1;
+    }
+    analyze();
+}
+
+int Liveness::Number(Location *var)
+{
+    std::map<Location*, int>::iterator found = indexFor.find(var);
+    if (found != indexFor.end())
+        return found->second;
+    vars.push_back(var);
+    return indexFor[var] = vars.size() - 1;
+}
+
+int Liveness::IndexOf(Location *var) const
+{
+    std::map<Location*, int>::const_iterator found = indexFor.find(var);
+    return (found == indexFor.end()) ? -1 : found->second;
+}
+
+
+/* Method: effect
+ * --------------
+ * live-before = (live-after - def) + uses, turning the set the
+ * analysis passes in from one into the other
+ */
+void Liveness::effect(int i, LiveSet& value)
+{
+    const Transfer& t = transfer[i];
+    if (t.kill != -1)
+        value.Remove(t.kill);
+    for (int g = 0; g < t.numGen; g++)
+        value.Insert(t.gen[g]);
+}
+
+void Liveness::meet(LiveSet& value, const LiveSet& other)
+{
+    value |= other;
+}
@@ -0,0 +1,61 @@
+/* File: liveness.h
+ * ----------------
+ * Live variable analysis over the CFG of a single function. A
+ * variable is live at a point if some path from that point reads it
+ * before writing it. Built on the DataFlow template walking the CFG
+ * backwards, so the "in" value of an instruction is what is live
+ * after it and the "out" value is what is live before it.
+ *
+ * The variables the function touches are numbered 0..NumVars()-1 up
+ * front and a LiveSet holds one bit per variable. The transfer for
+ * each instruction (the var it kills, the vars it reads) is also
+ * worked out once, kept by the CFG's instruction number and applied
+ * to the running set in place, so the analysis itself only moves
+ * bits.
+ */
+
+#ifndef _H_liveness
+#define _H_liveness
+
+#include <map>
+#include <vector>
+#include "df_base.h"
+#include "bitvector.h"
+class Location;
+
+typedef BitVector LiveSet;
+
+class Liveness : public DataFlow<LiveSet, ControlFlowGraph::ReverseFlow>
+{
+  public:
+    Liveness(ControlFlowGraph& cfg);
+
+          // By the CFG's instruction number
+    const LiveSet& LiveIn(int i)  { return data_out(i); }
+    const LiveSet& LiveOut(int i) { return data_in(i); }
+
+    int NumVars() const { return vars.size(); }
+    Location *Var(int index) const { return vars[index]; }
+    int IndexOf(Location *var) const; // -1 if the function never uses var
+
+  protected:
+    LiveSet init() { return LiveSet(vars.size()); }
+    LiveSet top()  { return LiveSet(vars.size()); }
+    void effect(int i, LiveSet& value);
+    void meet(LiveSet& value, const LiveSet& other);
+
+  private:
+    struct Transfer {
+        int kill;      // index of the var written, or -1
+        int gen[3];    // indices of the vars read
+        int numGen;
+    };
+
+    std::vector<Location*> vars;
+    std::map<Location*, int> indexFor;
+    std::vector<Transfer> transfer;  // by CFG instruction number
+
+    int Number(Location *var);
+};
+
+#endif
@@ -2,9 +2,10 @@
  * ----------------
  * This file just contains features relative to the location structure
  * used to record the lexical position of a token or symbol.  This file
- * establishes the cmoon definition for the yyltype structure, the global
- * variable yylloc, and a utility function to join locations you might
- * find handy at times.
+ * establishes the cmoon definition for the yyltype structure and a
+ * utility function to join locations you might find handy at times.
+ * (The parser is pure, so the location of the lexeme just scanned is
+ * passed to yylex rather than kept in a global yylloc.)
  */
 
 #ifndef YYLTYPE
@@ -25,14 +26,6 @@ typedef struct yyltype
 #define YYLTYPE yyltype
 
 
-/* Global variable: yylloc
- * ------------------------
- * The global variable holding the position information about the
- * lexeme just scanned.
- */
-extern struct yyltype yylloc;
-
-
 /* Function: Join
  * --------------
  * Takes two locations and returns a new location which represents
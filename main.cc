@@ -6,27 +6,39 @@
  
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <iostream>
 #include "utility.h"
-#include "errors.h"
-#include "parser.h"
+#include "compilation.h"
+#include "sourcefile.h"
 
 
 /* Function: main()
  * ----------------
- * Entry point to the entire program.  We parse the command line and turn
- * on any debugging flags requested by the user when invoking the program.
- * InitScanner() is used to set up the scanner.
- * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * Entry point to the entire program.  We parse the command line to get
+ * the optimization level and any debugging flags requested by the user
+ * when invoking the program, map the source file named (or read stdin
+ * if there is none) and run one Compilation over it (see compilation.h),
+ * which writes the assembly to stdout and any errors to stderr.
  */
 int main(int argc, char *argv[])
 {
     srand(time(NULL));
-    ParseCommandLine(argc, argv);
-  
-    InitScanner();
-    InitParser();
-    yyparse();
-    return (ReportError::NumErrors() == 0? 0 : -1);
-}
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16); // assembly is written in big chunks
+    DecafOptions options;
+    const char *sourceFile = NULL;
+    ParseCommandLine(argc, argv, &options, &sourceFile);
 
+    SourceFile source;
+    if (sourceFile ? !source.Map(sourceFile) : !source.Read(stdin)) {
+        std::cerr << "dcc: " << (sourceFile ? sourceFile : "stdin") << ": "
+                  << strerror(errno) << std::endl;
+        return 2;
+    }
+    Compilation compilation(options, std::cout, std::cerr);
+    compilation.RunInPlace(source.Text(), source.Length());
+    if (!options.cacheDir.empty())
+        std::cerr << "dcc: function cache: " << compilation.CacheHits() << " hits, "
+                  << compilation.CacheMisses() << " misses" << std::endl;
+    return (compilation.NumErrors() == 0? 0 : -1);
+}
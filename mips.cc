@@ -21,6 +21,8 @@
  */
 
 #include "mips.h"
+#include "regalloc.h"
+#include "codegen.h"
 #include <stdarg.h>
 #include <cstring>
 
@@ -29,19 +31,22 @@ static bool LocationsAreSame(Location *var1, Location *var2)
 {
     return (var1 == var2 ||
             (var1 && var2
-             && !strcmp(var1->GetName(), var2->GetName())
+             && var1->GetName() == var2->GetName() // interned
              && var1->GetSegment()  == var2->GetSegment()
              && var1->GetOffset() == var2->GetOffset()));
 }
 
 void Mips::EmitDiscardValue(Location *dst)
 {
-    // last use of value dst.
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    if (assignment) return; // nothing to discard, registers are preassigned
+    // last use of value dst, its register can go without a spill.
+    int reg = RD_lookup_RegisterForVar(dst);
+    if (reg == -1) return; // not in a register
+    Register rd = (Register) reg;
     Emit("\t\t#Last use of  %s. Discarding register_descriptor data for %s", 
           dst->GetName(), regs[rd].name); 
     regs[rd].canDiscard = true;
-    //DiscardValueInRegister(dst, rd);
+    DiscardValueInRegister(dst, rd);
 }
 
 void Mips::RD_insert(Location *varLoc, Register reg) {
@@ -52,10 +57,10 @@ void Mips::RD_insert(Location *varLoc, Register reg) {
         return;
     }
     if (RD_getRegContents(reg) != NULL) {
-        printf("#Dbg: register already in use\n");
+        Emit("#Dbg: register already in use\n");
     }
     if (regs[reg].isDirty) {
-        printf("#Dbg: Error, register is dirty.\n");
+        Emit("#Dbg: Error, register is dirty.\n");
         return;
     }
     register_descriptor.insert(std::pair<Register, Location*>(reg, varLoc));
@@ -70,7 +75,7 @@ void Mips::RD_remove(Location *varLoc, Register reg) {
     }
     if (!regs[reg].isDirty) {
         // we might not need this, other things might be marking it as clean.
-        printf("#Dbg: Error, register is not dirty.\n");
+        Emit("#Dbg: Error, register is not dirty.\n");
         return;
     }
     regs[reg].isDirty = false;
@@ -102,7 +107,7 @@ int Mips::RD_lookup_RegisterForVar(Location *varLoc) {
         // check the FPU ?
     }
     else {
-        printf("Dbg: Error, we found multiple copies of varLoc.\n");
+        Emit("Dbg: Error, we found multiple copies of varLoc.\n");
         return -10; // arbitrary, unused for now.
     }
 }
@@ -138,7 +143,7 @@ std::map<Mips::Register, Location*>::iterator Mips::RD_lookupIterForReg(Location
         return register_descriptor.end();
     }
     else {
-        printf("Dbg: Error, we found multiple copies of varLoc.\n");
+        Emit("Dbg: Error, we found multiple copies of varLoc.\n");
         return register_descriptor.end();
     }
 }
@@ -174,8 +179,8 @@ void Mips::FillRegister(Location *src, Register reg) {
             }
             else { // src is in different coprocessor reg
                 // move from coprocessor reg to coprocessor reg
-                Emit("mov.s %s, %s\t\t# move %s to %s", regs[rd].name, regs[f0].name,
-                     regs[f0].name, regs[rd].name);
+                Emit("mov.s %s, %s\t\t# move %s to %s", regs[reg].name, regs[previousReg].name,
+                     regs[previousReg].name, regs[reg].name);
             }
         }
     }
@@ -318,10 +323,10 @@ void Mips::regs_cleanRegister_T(Register reg) {
     }
     /*
     if (!regs[reg].isDirty) {
-        printf("Dbg: Error, register %s is already clean.\n", regs[reg].name);
+        Emit("Dbg: Error, register %s is already clean.\n", regs[reg].name);
     }
     if (RD_lookupIterForReg(varLoc) == register_descriptor.end()) {
-        printf("Dbg: Error, register is not in RD (but is still dirty?).\n");
+        Emit("Dbg: Error, register is not in RD (but is still dirty?).\n");
     }
     */
 
@@ -337,12 +342,12 @@ void Mips::regs_cleanRegister_T(Register reg) {
 
     /*
     if (regs[reg].isDirty) {
-        printf("Dbg: Error, register spilled but is dirty\n");
+        Emit("Dbg: Error, register spilled but is dirty\n");
     }
     if (RD_getRegContents(reg) != NULL) {
-        printf("Dbg: Error, register spilled but still has data.\n");
+        Emit("Dbg: Error, register spilled but still has data.\n");
         if (RD_lookupIterForReg(varLoc) != register_descriptor.end()) {
-            printf("Dbg: Error, register spilled but still in RD.\n");
+            Emit("Dbg: Error, register spilled but still in RD.\n");
         }
     }
     */
@@ -357,6 +362,45 @@ void Mips::regs_cleanForBranch() {
     }
     register_descriptor.clear();
 }
+
+/* Method: FetchOperand
+ * --------------------
+ * Under a register assignment, returns the register holding var. A
+ * var without a register of its own is loaded into scratch first.
+ */
+Mips::Register Mips::FetchOperand(Location *var, Register scratch)
+{
+    int reg = assignment->RegisterFor(var);
+    if (reg != -1)
+        return (Register) reg;
+    const char *offsetFromWhere = var->GetSegment() == fpRelative? regs[fp].name : regs[gp].name;
+    Emit("lw %s, %d(%s)\t# fill %s to %s from %s%+d", regs[scratch].name,
+         var->GetOffset(), offsetFromWhere, var->GetName(), regs[scratch].name,
+         offsetFromWhere, var->GetOffset());
+    return scratch;
+}
+
+/* Method: TargetFor
+ * -----------------
+ * Returns the register an instruction should write var into: its
+ * assigned register, or scratch if var lives in memory (in which case
+ * CommitTarget stores it back).
+ */
+Mips::Register Mips::TargetFor(Location *var, Register scratch)
+{
+    int reg = assignment->RegisterFor(var);
+    return (reg != -1) ? (Register) reg : scratch;
+}
+
+void Mips::CommitTarget(Location *var, Register reg)
+{
+    if (assignment->RegisterFor(var) != -1)
+        return;
+    const char *offsetFromWhere = var->GetSegment() == fpRelative? regs[fp].name : regs[gp].name;
+    Emit("sw %s, %d(%s)\t# spill %s from %s to %s%+d", regs[reg].name,
+         var->GetOffset(), offsetFromWhere, var->GetName(), regs[reg].name,
+         offsetFromWhere, var->GetOffset());
+}
 /*
 int Mips::nextCleanRegIndex() {
     for (int i = t4; i < k0; i++) {
@@ -406,20 +450,61 @@ void Mips::regs_cleanRegister_T(int index) {
  * ------------
  * General purpose helper used to emit assembly instructions in
  * a reasonable tidy manner.  Takes printf-style formatting strings
- * and variable arguments.
+ * and variable arguments.  Each line is formatted in place in a
+ * buffer (with room left in front for the indent) and appended to the
+ * output in a single step.
+ * With --lean-asm, comment lines are dropped and trailing comments
+ * are cut off.
  */
 void Mips::Emit(const char *fmt, ...)
 {
+    static const int Indent = 3;      // "\t" plus "  " at most
+    char buffer[4096];
+    char *buf = buffer, *text = buffer + Indent;
+    int size = sizeof(buffer) - Indent - 1; // keep room for a newline
     va_list args;
-    char buf[1024];
 
     va_start(args, fmt);
-    vsprintf(buf, fmt, args);
+    int len = vsnprintf(text, size, fmt, args);
     va_end(args);
-    if (buf[strlen(buf) - 1] != ':') printf("\t"); // don't tab in labels
-    if (buf[0] != '#') printf("  ");   // outdent comments a little
-    printf("%s", buf);
-    if (buf[strlen(buf)-1] != '\n') printf("\n"); // end with a newline
+    if (len >= size) {          // rare very long line (big string constant)
+        buf = new char[Indent + len + 2];
+        text = buf + Indent;
+        va_start(args, fmt);
+        vsnprintf(text, len + 1, fmt, args);
+        va_end(args);
+    }
+
+    if (LeanAssembly()) len = StripComment(text, len);
+    if (len > 0) {
+        char *start = text;
+        bool isLabel = (text[len-1] == ':'), isComment = (text[0] == '#');
+        if (!isComment) { *--start = ' '; *--start = ' '; } // outdent comments a little
+        if (!isLabel) *--start = '\t';                      // don't tab in labels
+        if (text[len-1] != '\n') text[len++] = '\n';       // end with a newline
+        output.append(start, text + len - start);
+    }
+    if (buf != buffer) delete[] buf;
+}
+
+/* Method: StripComment
+ * --------------------
+ * Used by Emit in lean mode.  Cuts the line at the first '#' that is
+ * not inside a string constant and trims the whitespace before it.
+ * Returns the new length, which is 0 if the whole line was a comment.
+ */
+int Mips::StripComment(char *text, int len)
+{
+    bool quoted = false;
+    for (int i = 0; i < len; i++) {
+        if (quoted && text[i] == '\\') i++;          // skip escaped char
+        else if (text[i] == '"') quoted = !quoted;
+        else if (!quoted && text[i] == '#') { len = i; break; }
+    }
+    while (len > 0 && (text[len-1] == ' ' || text[len-1] == '\t' || text[len-1] == '\n'))
+        len--;
+    text[len] = '\0';
+    return len;
 }
 
 /* Method: EmitLoadConstant
@@ -439,7 +524,15 @@ void Mips::EmitLoadConstant(Location *dst, int val)
     }
     */
 
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    if (assignment) {
+        Register rd = TargetFor(dst, v1);
+        Emit("li %s, %d\t\t# load constant value %d into %s", regs[rd].name,
+             val, val, regs[rd].name);
+        CommitTarget(dst, rd);
+        return;
+    }
+
+    Register rd = (Register) regs_pickRegForVar_T(dst, false);
     regs[rd].mutexLocked = true;
 
     //FillRegister(dst,rd);
@@ -458,9 +551,8 @@ void Mips::EmitLoadConstant(Location *dst, int val)
  */
 void Mips::EmitLoadStringConstant(Location *dst, const char *str)
 {
-    static int strNum = 1;
-    char label[16];
-    sprintf(label, "_string%d", strNum++);
+    char label[24];  // room for any int
+    sprintf(label, "_string%d", nextStringNum++);
     Emit(".data\t\t\t# create string constant marked with label");
     Emit("%s: .asciiz %s", label, str);
     Emit(".text");
@@ -475,7 +567,13 @@ void Mips::EmitLoadStringConstant(Location *dst, const char *str)
  */
 void Mips::EmitLoadLabel(Location *dst, const char *label)
 {
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    if (assignment) {
+        Register rd = TargetFor(dst, v1);
+        Emit("la %s, %s\t# load label", regs[rd].name, label);
+        CommitTarget(dst, rd);
+        return;
+    }
+    Register rd = (Register) regs_pickRegForVar_T(dst, false);
     regs[rd].mutexLocked = true;
     //FillRegister(dst,rd);
     Emit("la %s, %s\t# load label", regs[rd].name, label);
@@ -492,18 +590,22 @@ void Mips::EmitLoadLabel(Location *dst, const char *label)
  */
 void Mips::EmitCopy(Location *dst, Location *src)
 {
+    if (assignment) {
+        Register rs = FetchOperand(src, a0);
+        Register rd = TargetFor(dst, rs);
+        if (rd != rs)
+            Emit("move %s, %s\t\t# move (copy) %s from %s to %s in %s", regs[rd].name, regs[rs].name,
+                 src->GetName(), regs[rs].name, dst->GetName(), regs[rd].name);
+        CommitTarget(dst, rd);
+        return;
+    }
 
-    rs = (Register) regs_pickRegForVar_T(src, false);
+    Register rs = (Register) regs_pickRegForVar_T(src, false);
     regs[rs].mutexLocked = true;
     FillRegister(src, rs);
     RD_insert(src, rs);
 
-    // If rs will never be used again, send it to a black hold.
-    if (regs[rs].canDiscard == true) {
-        DiscardValueInRegister(src, rs);
-    }
-
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    Register rd = (Register) regs_pickRegForVar_T(dst, false);
     regs[rd].mutexLocked = true;
 
     //  FillRegister(src, rs);
@@ -529,12 +631,20 @@ void Mips::EmitCopy(Location *dst, Location *src)
  */
 void Mips::EmitLoad(Location *dst, Location *reference, int offset)
 {
-    rs = (Register) regs_pickRegForVar_T(reference, false);
+    if (assignment) {
+        Register rs = FetchOperand(reference, a0);
+        Register rd = TargetFor(dst, v1);
+        Emit("lw %s, %d(%s) \t# load with offset", regs[rd].name,
+             offset, regs[rs].name);
+        CommitTarget(dst, rd);
+        return;
+    }
+    Register rs = (Register) regs_pickRegForVar_T(reference, false);
     regs[rs].mutexLocked = true;
     FillRegister(reference, rs);
     RD_insert(reference, rs);
 
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    Register rd = (Register) regs_pickRegForVar_T(dst, false);
     regs[rd].mutexLocked = true;
 
     
@@ -559,13 +669,20 @@ void Mips::EmitLoad(Location *dst, Location *reference, int offset)
  */
 void Mips::EmitStore(Location *reference, Location *value, int offset)
 {
-    rs = (Register) regs_pickRegForVar_T(value, false);
+    if (assignment) {
+        Register rs = FetchOperand(value, a0);
+        Register rd = FetchOperand(reference, a1);
+        Emit("sw %s, %d(%s) \t# store with offset",
+             regs[rs].name, offset, regs[rd].name);
+        return;
+    }
+    Register rs = (Register) regs_pickRegForVar_T(value, false);
     regs[rs].mutexLocked = true;
     FillRegister(value, rs);
     RD_insert(value, rs);
 
 
-    rd = (Register) regs_pickRegForVar_T(reference, false);
+    Register rd = (Register) regs_pickRegForVar_T(reference, false);
     regs[rd].mutexLocked = true;
     FillRegister(reference, rd);
     RD_insert(reference, rd);
@@ -624,25 +741,32 @@ void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
         FP_EmitBinaryOp("neg.s", dst, op1, op2); // look at this later
     }
     */
+    else if (assignment) {
+        Register rs = FetchOperand(op1, a0);
+        Register rt = FetchOperand(op2, a1);
+        Register rd = TargetFor(dst, v1);
+        Emit("%s %s, %s, %s\t", NameForTac(code), regs[rd].name,
+             regs[rs].name, regs[rt].name);
+        CommitTarget(dst, rd);
+    }
     else {
-        rs = (Register) regs_pickRegForVar_T(op1, false);
+        Register rs = (Register) regs_pickRegForVar_T(op1, false);
         regs[rs].mutexLocked = true;
         FillRegister(op1,rs);
         RD_insert(op1,rs);
 
-        rt = (Register) regs_pickRegForVar_T(op2, false);
+        Register rt = (Register) regs_pickRegForVar_T(op2, false);
         regs[rt].mutexLocked = true;
         FillRegister(op2,rt);
         RD_insert(op2,rt);
 
-        rd = (Register) regs_pickRegForVar_T(dst, false);
+        Register rd = (Register) regs_pickRegForVar_T(dst, false);
         regs[rd].mutexLocked = true;
 
         //FillRegister(dst,rd);
         Emit("%s %s, %s, %s\t", NameForTac(code), regs[rd].name,
              regs[rs].name, regs[rt].name);
         RD_insert(dst, rd);
-        regs[rd].canDiscard = true;
         regs[rs].mutexLocked = false;
         regs[rt].mutexLocked = false;
         regs[rd].mutexLocked = false;
@@ -655,7 +779,7 @@ void Mips::FP_EmitBinaryOp(const char* operation, Location *dst,
 {
     //fpu rs~f2, rt~f4, rd~f0 , fpu uses even regs.
     // note: neg is broken.
-    rd = (Register) regs_pickRegForVar_T(dst, false);
+    Register rd = (Register) regs_pickRegForVar_T(dst, false);
     regs[rd].mutexLocked = true;
     regs[f0].mutexLocked = true;
     regs[f2].mutexLocked = true;
@@ -698,8 +822,8 @@ void Mips::FP_EmitBinaryOp(const char* operation, Location *dst,
  */
 void Mips::EmitLabel(const char *label)
 {
-
-    regs_cleanForBranch();
+    if (!assignment)
+        regs_cleanForBranch();
     Emit("%s:", label);
 }
 
@@ -713,8 +837,8 @@ void Mips::EmitLabel(const char *label)
  */
 void Mips::EmitGoto(const char *label)
 {
-
-    regs_cleanForBranch();
+    if (!assignment)
+        regs_cleanForBranch();
     Emit("b %s\t\t# unconditional branch", label);
 }
 
@@ -728,6 +852,12 @@ void Mips::EmitGoto(const char *label)
  */
 void Mips::EmitIfZ(Location *test, const char *label)
 {
+    if (assignment) {
+        Register rs = FetchOperand(test, a0);
+        Emit("beqz %s, %s\t# branch if %s is zero ", regs[rs].name, label,
+             test->GetName());
+        return;
+    }
     /*
     rs = (Register) regs_pickRegForVar_T(test, false);
     regs[rs].mutexLocked = true;
@@ -750,8 +880,14 @@ void Mips::EmitIfZ(Location *test, const char *label)
  */
 void Mips::EmitParam(Location *arg)
 {
+    if (assignment) {
+        Register rs = FetchOperand(arg, a0);
+        Emit("subu $sp, $sp, 4\t# decrement sp to make space for param");
+        Emit("sw %s, 4($sp)\t# copy param value to stack", regs[rs].name);
+        return;
+    }
 
-    rs = (Register) regs_pickRegForVar_T(arg, false);
+    Register rs = (Register) regs_pickRegForVar_T(arg, false);
     regs[rs].mutexLocked = true;
 
     FillRegister(arg, rs);
@@ -775,9 +911,20 @@ void Mips::EmitParam(Location *arg)
  */
 void Mips::EmitCallInstr(Location *result, const char *fn, bool isLabel)
 {
+    if (assignment) {
+        Emit("%s %-15s\t# jump to function", isLabel? "jal": "jalr", fn);
+        if (result != NULL) {
+            Register rd = TargetFor(result, v0);
+            if (rd != v0)
+                Emit("move %s, %s\t\t# copy function return value from $v0",
+                     regs[rd].name, regs[v0].name);
+            CommitTarget(result, rd);
+        }
+        return;
+    }
     regs_cleanForBranch();
     if (result != NULL) {
-        rd = (Register) regs_pickRegForVar_T(result, false);
+        Register rd = (Register) regs_pickRegForVar_T(result, false);
         regs[rd].mutexLocked = true;
         Emit("%s %-15s\t# jump to function", isLabel? "jal": "jalr", fn);
         Emit("move %s, %s\t\t# copy function return value from $v0",
@@ -799,6 +946,11 @@ void Mips::EmitLCall(Location *dst, const char *label)
 
 void Mips::EmitACall(Location *dst, Location *fn)
 {
+    if (assignment) {
+        Register rs = FetchOperand(fn, a0);
+        EmitCallInstr(dst, regs[rs].name, false);
+        return;
+    }
     FillRegister(fn, v0);
     EmitCallInstr(dst, regs[v0].name, false);
 }
@@ -820,20 +972,29 @@ void Mips::EmitPopParams(int bytes)
  * explicit return or falling off the end of the function body).
  * If there is an expression to return, we save that variable into
  * a register and move its contents to $v0 (the standard register for
- * function result).  Before exiting, we spill dirty registers (to
- * commit contents of saved registers to memory, necessary for
- * consistency, see comments at SpillForEndFunction above). We also
+ * function result).  Before exiting, we spill dirty registers holding
+ * globals (to commit them to memory, necessary for consistency; the
+ * locals go away with the frame anyway). We also
  * do the last part of the callee's job in function call protocol,
  * which is to remove our locals/temps from the stack, remove
  * saved registers ($fp and $ra) and restore previous values of
  * $fp and $ra so everything is returned to the state we entered.
- * We then emit jr to jump to the saved $ra.
+ * With a register assignment, the $s registers it uses are restored
+ * from where EmitBeginFunction saved them. We then emit jr to jump to
+ * the saved $ra.
  */
 void Mips::EmitReturn(Location *returnVal)
 {
     // need to spill as per directions above
     //regs_cleanForBranch();
-    if (returnVal != NULL)
+    if (returnVal != NULL && assignment)
+    {
+        Register rs = FetchOperand(returnVal, v0);
+        if (rs != v0)
+            Emit("move $v0, %s\t\t# assign return value into $v0",
+                 regs[rs].name);
+    }
+    else if (returnVal != NULL)
     {
         FillRegister(returnVal, v0);
         /*
@@ -842,6 +1003,22 @@ void Mips::EmitReturn(Location *returnVal)
              regs[rd].name);
              */
     }
+    if (assignment) {
+        int offset = calleeSaveOffset;
+        for (int r = s0; r <= s7; r++) {
+            if (!assignment->Uses((Register) r)) continue;
+            Emit("lw %s, %d($fp)\t# restore callee-saved register",
+                 regs[r].name, offset);
+            offset -= 4;
+        }
+    } else {
+        // locals die with the frame, but globals must reach memory
+        for (int i = t0; i <= t9; i++) {
+            Location *var = RD_getRegContents((Register) i);
+            if (regs[i].isDirty && var && var->GetSegment() == gpRelative)
+                SpillRegister(var, (Register) i);
+        }
+    }
     Emit("move $sp, $fp\t\t# pop callee frame off stack");
     Emit("lw $ra, -4($fp)\t# restore saved ra");
     Emit("lw $fp, 0($fp)\t# restore saved fp");
@@ -855,7 +1032,9 @@ void Mips::EmitReturn(Location *returnVal)
  * upon entering a new function. We decrement the $sp to make space
  * and then save the current values of $fp and $ra (since we are
  * going to change them), then set up the $fp and bump the $sp down
- * to make space for all our locals/temps.
+ * to make space for all our locals/temps. With a register assignment,
+ * the frame also holds a slot below the locals for each $s register
+ * the function uses, which we save there for EmitReturn to restore.
  */
 void Mips::EmitBeginFunction(int stackFrameSize)
 {
@@ -865,9 +1044,32 @@ void Mips::EmitBeginFunction(int stackFrameSize)
     Emit("sw $ra, 4($sp)\t# save ra");
     Emit("addiu $fp, $sp, 8\t# set up new fp");
 
-    if (stackFrameSize != 0)
+    int numSaved = 0;
+    if (assignment)
+        for (int r = s0; r <= s7; r++)
+            if (assignment->Uses((Register) r)) numSaved++;
+
+    if (stackFrameSize + 4*numSaved != 0)
         Emit("subu $sp, $sp, %d\t# decrement sp to make space for locals/temps",
-             stackFrameSize);
+             stackFrameSize + 4*numSaved);
+
+    calleeSaveOffset = CodeGenerator::OffsetToFirstLocal - stackFrameSize;
+    if (assignment) {
+        int offset = calleeSaveOffset;
+        for (int r = s0; r <= s7; r++) {
+            if (!assignment->Uses((Register) r)) continue;
+            Emit("sw %s, %d($fp)\t# save callee-saved register",
+                 regs[r].name, offset);
+            offset -= 4;
+        }
+
+        // vars already holding a value get loaded up front
+        const List<Location*> &entry = assignment->LiveOnEntry();
+        for (int i = 0; i < entry.NumElements(); i++) {
+            Location *var = entry.Nth(i);
+            FillRegister(var, (Register) assignment->RegisterFor(var));
+        }
+    }
 }
 
 
@@ -881,6 +1083,11 @@ void Mips::EmitEndFunction()
 {
     Emit("# (below handles reaching end of fn body with no explicit return)");
     EmitReturn(NULL);
+
+    // the frame is gone, so is whatever the registers held for it
+    for (int i = t0; i <= t9; i++)
+        regs[i].isDirty = regs[i].canDiscard = false;
+    register_descriptor.clear();
 }
 
 
@@ -891,13 +1098,13 @@ void Mips::EmitEndFunction()
  * entry in data segment, emits label, and lays out the function
  * labels one after another.
  */
-void Mips::EmitVTable(const char *label, List<const char*> *methodLabels)
+void Mips::EmitVTable(const char *label, const char * const *methodLabels, int numMethods)
 {
     Emit(".data");
     Emit(".align 2");
     Emit("%s:\t\t# label for class %s vtable", label, label);
-    for (int i = 0; i < methodLabels->NumElements(); i++)
-        Emit(".word %s\n", methodLabels->Nth(i));
+    for (int i = 0; i < numMethods; i++)
+        Emit(".word %s\n", methodLabels[i]);
     Emit(".text");
 }
 
@@ -933,19 +1140,13 @@ const char *Mips::NameForTac(BinaryOp::OpCode code)
 
 /* Constructor
  * ----------
- * Constructor sets up the mips names and register descriptors to
- * the initial starting state.
+ * Constructor sets up the register descriptors to the initial
+ * starting state.
  */
-Mips::Mips() {
-    mipsName[BinaryOp::Add] = "add";
-    mipsName[BinaryOp::Sub] = "sub";
-    mipsName[BinaryOp::Mul] = "mul";
-    mipsName[BinaryOp::Div] = "div";
-    mipsName[BinaryOp::Mod] = "rem";
-    mipsName[BinaryOp::Eq] = "seq";
-    mipsName[BinaryOp::Less] = "slt";
-    mipsName[BinaryOp::And] = "and";
-    mipsName[BinaryOp::Or] = "or";
+Mips::Mips(int firstStringNum) {
+    assignment = NULL;
+    nextStringNum = firstStringNum;
+    calleeSaveOffset = 0;
 
    regs[zero] = (RegContents){false, NULL, "$zero", false, false, false};
    regs[at] = (RegContents){false, NULL, "$at", false, false, false};
@@ -1016,6 +1217,7 @@ Mips::Mips() {
    regs[f30] = (RegContents){false, NULL, "$f30", true, false, false};
    regs[f31] = (RegContents){false, NULL, "$f31", true, false, false};
 }
-const char *Mips::mipsName[BinaryOp::NumOps];
+    // in BinaryOp::OpCode order
+const char * const Mips::mipsName[BinaryOp::NumOps] = {"add", "sub", "mul", "div", "rem", "seq", "slt", "and", "or"};
 
 
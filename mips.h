@@ -9,6 +9,11 @@
  * it does.  You will not need to modify this class unless
  * you're attempting some machine-specific optimizations. 
  *
+ * The assembly goes into a buffer of the Mips object's own, which the
+ * owner takes with TakeText. Nothing is shared between Mips objects,
+ * so the backend uses one per code unit and translates several units
+ * at once (see CodeGenerator::DoFinalCodeGen).
+ *
  * It comments the emitted assembly but the commenting for the code
  * in the class itself is pretty sparse. The SPIM manual (see link
  * from other materials on our web site) has more detailed documentation
@@ -22,11 +27,13 @@
 #include "list.h"
 #include "cfg.h"
 #include <map> 
+#include <string>
 class Location;
+class RegisterAssignment;
 
 
 class Mips {
-  private:
+  public:
     typedef enum {
             zero, at, v0, v1, a0, a1, a2, a3, 
 			s0, s1, s2, s3, s4, s5, s6, s7,
@@ -37,6 +44,8 @@ class Mips {
             f15, f16, f17, f18, f19, f20, f21, 
             f22, f23, f24, f25, f26, f27, f28,
             f29, f30, f31 } Register;
+
+  private:
     // 31 regular 32 fp
     struct RegContents {
 	bool isDirty;
@@ -47,8 +56,6 @@ class Mips {
     bool canDiscard;
     } regs[64];
 
-    Register rs, rt, rd;
-
     std::map<Register, Location*> register_descriptor;
     //std::map<Location*, Register> copyOf_register_descriptor;
     int oldestTmpReg;
@@ -97,17 +104,36 @@ class Mips {
     std::map<Register, Location*>::iterator RD_lookupIterForReg(Location *varLoc);
 
 
+    /* operands under a global register assignment (see regalloc.h) */
+    const RegisterAssignment *assignment;
+    int calleeSaveOffset; // fp offset of the slot for the first saved $s
+    Register FetchOperand(Location *var, Register scratch);
+    Register TargetFor(Location *var, Register scratch);
+    void CommitTarget(Location *var, Register reg);
+
     /* everything else */
+    static int StripComment(char *text, int len);
     void EmitCallInstr(Location *dst, const char *fn, bool isL);
     
-    static const char *mipsName[BinaryOp::NumOps];
+    static const char * const mipsName[BinaryOp::NumOps];
     static const char *NameForTac(BinaryOp::OpCode code);
 
     Instruction* currentInstruction;
+    int nextStringNum;    // for labels of string constants
+    std::string output;   // assembly emitted so far
  public:
-    Mips();
-
-    static void Emit(const char *fmt, ...);
+        // String constants get labels _string<n>, numbered from
+        // firstStringNum in the order they are emitted
+    Mips(int firstStringNum = 1);
+
+    void Emit(const char *fmt, ...);
+    void TakeText(std::string *text) { text->swap(output); output.clear(); }
+
+        // When an assignment is set, variables stay in the registers it
+        // gives them for the whole function and everything else is kept
+        // in memory, so no spilling happens at labels, branches or calls.
+        // Set before BeginFunc, cleared (NULL) after EndFunc.
+    void SetRegisterAssignment(const RegisterAssignment *ra) { assignment = ra; }
     
     void EmitDiscardValue(Location *dst);
 
@@ -137,7 +163,7 @@ class Mips {
     void EmitACall(Location *result, Location *fnAddr);
     void EmitPopParams(int bytes);
 
-    void EmitVTable(const char *label, List<const char*> *methodLabels);
+    void EmitVTable(const char *label, const char * const *methodLabels, int numMethods);
 
     void EmitPreamble();
 
@@ -10,6 +10,7 @@
   // here we need to include things needed for the yylval union
   // (types, classes, constants, etc.)
   
+#include <iosfwd>
 #include "scanner.h"            // for MaxIdentLen
 #include "list.h"       	// because we use all these types
 #include "ast.h"		// in the union, we need their declarations
@@ -28,11 +29,15 @@
 // we are compiling y.tab.c, which we use the YYBISON symbol for. 
 // Managing C headers can be such a mess! 
 
+class FlatTree;
+
 #ifndef YYBISON                 
 #include "y.tab.h"              
 #endif
 
-int yyparse();              // Defined in the generated y.tab.c file
+int yyparse(void *scanner, FlatTree *flat); // Defined in the generated y.tab.c file
 void InitParser();          // Defined in parser.y
+void DumpTokens(void *scanner, std::ostream& out); // ditto, for -d tokens
+int CountTokens(void *scanner);                    // ditto, for -d scan
 
 #endif
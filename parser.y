@@ -5,14 +5,29 @@
 
 %{
 
+#include <ostream>
+#include <stdio.h>
 #include "scanner.h" // for yylex
 #include "parser.h"
 #include "errors.h"
+#include "timing.h"
+#include "flatast.h"
 
-void yyerror(const char *msg); // standard error-handling routine
+void yyerror(yyltype *loc, void *scanner, FlatTree *flat, const char *msg); // standard error-handling routine
 
 %}
 
+/* The parser is pure: the scanner it reads from is passed in to
+ * yyparse and on to each yylex, along with where to put yylval and
+ * yylloc, so nothing is kept in globals between compilations. So is
+ * the flat tree to build the function bodies in, NULL for nodes.
+ */
+%define api.pure full
+%locations
+%parse-param { void *scanner }
+%parse-param { FlatTree *flat }
+%lex-param   { void *scanner }
+
  
 /* yylval 
  * ------
@@ -36,6 +51,8 @@ void yyerror(const char *msg); // standard error-handling routine
     Stmt *stmt;
     List<Stmt*> *stmtList;
     LValue *lvalue;
+    int node;              // the body's parts, when built flat
+    List<int> *nodeList;
 }
 
 
@@ -97,6 +114,7 @@ void yyerror(const char *msg); // standard error-handling routine
  */
 Program   :    DeclList            { 
                                       @1; 
+                                      EndPhase(ParsePhase);
                                       Program *program = new Program($1);
                                       // if no errors, advance to next phase
                                       if (ReportError::NumErrors() == 0) 
@@ -185,107 +203,157 @@ FormalList:    FormalList ',' Variable
           |    Variable             { ($$ = new List<VarDecl*>)->Append($1); }
           ;
 
-FnDecl    :    FnHeader StmtBlock   { ($$=$1)->SetFunctionBody($2); }
+FnDecl    :    FnHeader StmtBlock   { if (flat) ($$=$1)->SetFlatBody(flat, $<node>2);
+                                      else ($$=$1)->SetFunctionBody($2); }
           ;
 
+/* The function bodies: with a flat tree (see flatast.h) each action
+ * adds to it and the values are node indices (<node>, <nodeList>),
+ * otherwise it makes the nodes as usual.
+ */
 StmtBlock :    '{' VarDecls StmtList '}' 
-                                    { $$ = new StmtBlock($2, $3); }
+                                    { if (flat) $<node>$ = flat->Block($2, $<nodeList>3);
+                                      else $$ = new StmtBlock($2, $3); }
+          |    '{' VarDecls '}'     { if (flat) $<node>$ = flat->Block($2, new List<int>);
+                                      else $$ = new StmtBlock($2, new List<Stmt*>); }
           ;
 
 VarDecls  :    VarDecls VarDecl     { ($$=$1)->Append($2); }
           |    /* empty */          { $$ = new List<VarDecl*>; }
           ;
 
-StmtList  :    Stmt StmtList        { $$ = $2; $$->InsertAt($1, 0); }
-          |    /* empty */          { $$ = new List<Stmt*>; }
+StmtList  :    StmtList Stmt        { if (flat) ($<nodeList>$=$<nodeList>1)->Append($<node>2);
+                                      else ($$=$1)->Append($2); }
+          |    Stmt                 { if (flat) ($<nodeList>$ = new List<int>)->Append($<node>1);
+                                      else ($$ = new List<Stmt*>)->Append($1); }
           ;
 
-Stmt      :    OptExpr ';'          { $$ = $1; }
+Stmt      :    OptExpr ';'          { if (flat) $<node>$ = $<node>1; else $$ = $1; }
           |    StmtBlock
           |    T_If '(' Expr ')' Stmt OptElse 
-                                    { $$ = new IfStmt($3, $5, $6); }
+                                    { if (flat) $<node>$ = flat->If($<node>3, $<node>5, $<node>6);
+                                      else $$ = new IfStmt($3, $5, $6); }
           |    T_While '(' Expr ')' Stmt 
-                                    { $$ = new WhileStmt($3, $5); }
+                                    { if (flat) $<node>$ = flat->While($<node>3, $<node>5);
+                                      else $$ = new WhileStmt($3, $5); }
           |    T_For '(' OptExpr ';' Expr ';' OptExpr ')' Stmt 
-                                    { $$ = new ForStmt($3, $5, $7, $9); } 
+                                    { if (flat) $<node>$ = flat->For($<node>3, $<node>5, $<node>7, $<node>9);
+                                      else $$ = new ForStmt($3, $5, $7, $9); } 
           |    T_Return Expr ';'      
-                                    { $$ = new ReturnStmt(@2, $2); }
+                                    { if (flat) $<node>$ = flat->Return(@2, $<node>2);
+                                      else $$ = new ReturnStmt(@2, $2); }
           |    T_Return ';'      
-                                    { $$ = new ReturnStmt(@1, new EmptyExpr()); }
+                                    { if (flat) $<node>$ = flat->Return(@1, flat->Empty());
+                                      else $$ = new ReturnStmt(@1, new EmptyExpr()); }
           |    T_Print '(' ExprList ')' ';'  
-                                    { $$ = new PrintStmt($3); }
-          |    T_Break ';'          { $$ = new BreakStmt(@1); }
+                                    { if (flat) $<node>$ = flat->Print($<nodeList>3);
+                                      else $$ = new PrintStmt($3); }
+          |    T_Break ';'          { if (flat) $<node>$ = flat->Break(@1);
+                                      else $$ = new BreakStmt(@1); }
           ;
 
-LValue    :    T_Identifier          { $$ = new FieldAccess(NULL, new Identifier(@1, $1)); }
-          |    Expr '.' T_Identifier { $$ = new FieldAccess($1, new Identifier(@3, $3)); } 
-          |    Expr '[' Expr ']'     { $$ = new ArrayAccess(Join(@1, @4), $1, $3); }
+LValue    :    T_Identifier          { if (flat) $<node>$ = flat->Field(FlatTree::None, @1, $1);
+                                       else $$ = new FieldAccess(NULL, new Identifier(@1, $1)); }
+          |    Expr '.' T_Identifier { if (flat) $<node>$ = flat->Field($<node>1, @3, $3);
+                                       else $$ = new FieldAccess($1, new Identifier(@3, $3)); } 
+          |    Expr '[' Expr ']'     { if (flat) $<node>$ = flat->Index(Join(@1, @4), $<node>1, $<node>3);
+                                       else $$ = new ArrayAccess(Join(@1, @4), $1, $3); }
           ;
 
 Call      :    T_Identifier '(' Actuals ')' 
-                                    { $$ = new Call(Join(@1,@4), NULL, new Identifier(@1,$1), $3); }
+                                    { if (flat) $<node>$ = flat->Call(Join(@1,@4), FlatTree::None, @1, $1, $<nodeList>3);
+                                      else $$ = new Call(Join(@1,@4), NULL, new Identifier(@1,$1), $3); }
           |    Expr '.' T_Identifier '(' Actuals ')' 
-                                    { $$ = new Call(Join(@1,@6), $1, new Identifier(@3,$3), $5); }
+                                    { if (flat) $<node>$ = flat->Call(Join(@1,@6), $<node>1, @3, $3, $<nodeList>5);
+                                      else $$ = new Call(Join(@1,@6), $1, new Identifier(@3,$3), $5); }
           ;
 
-OptExpr   :    Expr                 { $$ = $1; }
-          |    /* empty */          { $$ = new EmptyExpr(); }
+OptExpr   :    Expr                 { if (flat) $<node>$ = $<node>1; else $$ = $1; }
+          |    /* empty */          { if (flat) $<node>$ = flat->Empty(); else $$ = new EmptyExpr(); }
           ;
 
-Expr      :    LValue               { $$ = $1; }
+Expr      :    LValue               { if (flat) $<node>$ = $<node>1; else $$ = $1; }
           |    Call
           |    Constant
-          |    LValue '=' Expr      { $$ = new AssignExpr($1, new Operator(@2,"="), $3); }
-          |    Expr '+' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "+"), $3); }
-          |    Expr '-' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "-"), $3); }
-          |    Expr '/' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"/"), $3); }
-          |    Expr '*' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"*"), $3); }
-          |    Expr '%' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"%"), $3); }
-          |    Expr T_Equal Expr    { $$ = new EqualityExpr($1, new Operator(@2,"=="), $3); }
-          |    Expr T_NotEqual Expr { $$ = new EqualityExpr($1, new Operator(@2,"!="), $3); }
-          |    Expr '<' Expr        { $$ = new RelationalExpr($1, new Operator(@2,"<"), $3); }
-          |    Expr '>' Expr        { $$ = new RelationalExpr($1, new Operator(@2,">"), $3); }
+          |    LValue '=' Expr      { if (flat) $<node>$ = flat->Operation(@2, "=", $<node>1, $<node>3);
+                                      else $$ = new AssignExpr($1, new Operator(@2,"="), $3); }
+          |    Expr '+' Expr        { if (flat) $<node>$ = flat->Operation(@2, "+", $<node>1, $<node>3);
+                                      else $$ = new ArithmeticExpr($1, new Operator(@2, "+"), $3); }
+          |    Expr '-' Expr        { if (flat) $<node>$ = flat->Operation(@2, "-", $<node>1, $<node>3);
+                                      else $$ = new ArithmeticExpr($1, new Operator(@2, "-"), $3); }
+          |    Expr '/' Expr        { if (flat) $<node>$ = flat->Operation(@2, "/", $<node>1, $<node>3);
+                                      else $$ = new ArithmeticExpr($1, new Operator(@2,"/"), $3); }
+          |    Expr '*' Expr        { if (flat) $<node>$ = flat->Operation(@2, "*", $<node>1, $<node>3);
+                                      else $$ = new ArithmeticExpr($1, new Operator(@2,"*"), $3); }
+          |    Expr '%' Expr        { if (flat) $<node>$ = flat->Operation(@2, "%", $<node>1, $<node>3);
+                                      else $$ = new ArithmeticExpr($1, new Operator(@2,"%"), $3); }
+          |    Expr T_Equal Expr    { if (flat) $<node>$ = flat->Operation(@2, "==", $<node>1, $<node>3);
+                                      else $$ = new EqualityExpr($1, new Operator(@2,"=="), $3); }
+          |    Expr T_NotEqual Expr { if (flat) $<node>$ = flat->Operation(@2, "!=", $<node>1, $<node>3);
+                                      else $$ = new EqualityExpr($1, new Operator(@2,"!="), $3); }
+          |    Expr '<' Expr        { if (flat) $<node>$ = flat->Operation(@2, "<", $<node>1, $<node>3);
+                                      else $$ = new RelationalExpr($1, new Operator(@2,"<"), $3); }
+          |    Expr '>' Expr        { if (flat) $<node>$ = flat->Operation(@2, ">", $<node>1, $<node>3);
+                                      else $$ = new RelationalExpr($1, new Operator(@2,">"), $3); }
           |    Expr T_LessEqual Expr 
-                                    { $$ = new RelationalExpr($1, new Operator(@2,"<="), $3); }
+                                    { if (flat) $<node>$ = flat->Operation(@2, "<=", $<node>1, $<node>3);
+                                      else $$ = new RelationalExpr($1, new Operator(@2,"<="), $3); }
           |    Expr T_GreaterEqual Expr 
-                                    { $$ = new RelationalExpr($1, new Operator(@2,">="), $3); }
-          |    Expr T_And Expr      { $$ = new LogicalExpr($1, new Operator(@2,"&&"), $3); }
-          |    Expr T_Or Expr       { $$ = new LogicalExpr($1, new Operator(@2,"||"), $3); }
-          |    '(' Expr ')'         { $$ = $2; }
+                                    { if (flat) $<node>$ = flat->Operation(@2, ">=", $<node>1, $<node>3);
+                                      else $$ = new RelationalExpr($1, new Operator(@2,">="), $3); }
+          |    Expr T_And Expr      { if (flat) $<node>$ = flat->Operation(@2, "&&", $<node>1, $<node>3);
+                                      else $$ = new LogicalExpr($1, new Operator(@2,"&&"), $3); }
+          |    Expr T_Or Expr       { if (flat) $<node>$ = flat->Operation(@2, "||", $<node>1, $<node>3);
+                                      else $$ = new LogicalExpr($1, new Operator(@2,"||"), $3); }
+          |    '(' Expr ')'         { if (flat) $<node>$ = $<node>2; else $$ = $2; }
           |    '-' Expr  %prec T_UnaryMinus 
-                                    { $$ = new ArithmeticExpr(new Operator(@1,"-"), $2); }
-          |    '!' Expr             { $$ = new LogicalExpr(new Operator(@1,"!"), $2); }
+                                    { if (flat) $<node>$ = flat->Operation(@1, "-", FlatTree::None, $<node>2);
+                                      else $$ = new ArithmeticExpr(new Operator(@1,"-"), $2); }
+          |    '!' Expr             { if (flat) $<node>$ = flat->Operation(@1, "!", FlatTree::None, $<node>2);
+                                      else $$ = new LogicalExpr(new Operator(@1,"!"), $2); }
           |    T_ReadInteger '(' ')'   
-                                    { $$ = new ReadIntegerExpr(Join(@1,@3)); }
-          |    T_ReadLine '(' ')'   { $$ = new ReadLineExpr(Join(@1,@3)); }
+                                    { if (flat) $<node>$ = flat->Leaf(FlatTree::ReadIntCall, Join(@1,@3));
+                                      else $$ = new ReadIntegerExpr(Join(@1,@3)); }
+          |    T_ReadLine '(' ')'   { if (flat) $<node>$ = flat->Leaf(FlatTree::ReadLineCall, Join(@1,@3));
+                                      else $$ = new ReadLineExpr(Join(@1,@3)); }
           |    T_New '(' T_Identifier ')' 
-                                    { $$ = new NewExpr(Join(@1,@4),new NamedType(new Identifier(@3,$3))); }
+                                    { if (flat) $<node>$ = flat->New(Join(@1,@4), @3, $3);
+                                      else $$ = new NewExpr(Join(@1,@4),new NamedType(new Identifier(@3,$3))); }
           |    T_NewArray '(' Expr ',' Type ')' 
-                                    { $$ = new NewArrayExpr(Join(@1,@6),$3, $5); }
-          |    T_This               { $$ = new This(@1); }
+                                    { if (flat) $<node>$ = flat->NewArray(Join(@1,@6), $<node>3, $5);
+                                      else $$ = new NewArrayExpr(Join(@1,@6),$3, $5); }
+          |    T_This               { if (flat) $<node>$ = flat->Leaf(FlatTree::ThisRef, @1);
+                                      else $$ = new This(@1); }
           ;
 
-Constant  :    T_IntConstant        { $$ = new IntConstant(@1,$1); }
-          |    T_BoolConstant       { $$ = new BoolConstant(@1,$1); }
+Constant  :    T_IntConstant        { if (flat) $<node>$ = flat->Constant(FlatTree::IntLit, @1, $1);
+                                      else $$ = new IntConstant(@1,$1); }
+          |    T_BoolConstant       { if (flat) $<node>$ = flat->Constant(FlatTree::BoolLit, @1, $1);
+                                      else $$ = new BoolConstant(@1,$1); }
           |    T_DoubleConstant     
 				
                                     { ReportError::Formatted(&@1, "No code gen for doubles");
-                                      $$ = new IntConstant(@1,$1); }
-          |    T_StringConstant     { $$ = new StringConstant(@1,$1); }
-          |    T_Null               { $$ = new NullConstant(@1); }
+                                      if (flat) $<node>$ = flat->Constant(FlatTree::IntLit, @1, $1);
+                                      else $$ = new IntConstant(@1,$1); }
+          |    T_StringConstant     { if (flat) $<node>$ = flat->String(@1, $1);
+                                      else $$ = new StringConstant(@1,$1); }
+          |    T_Null               { if (flat) $<node>$ = flat->Constant(FlatTree::NullLit, @1, 0);
+                                      else $$ = new NullConstant(@1); }
           ;
 
-Actuals   :    ExprList             { $$ = $1; }
-          |    /* empty */          { $$ = new List<Expr*>; }
+Actuals   :    ExprList             { if (flat) $<nodeList>$ = $<nodeList>1; else $$ = $1; }
+          |    /* empty */          { if (flat) $<nodeList>$ = new List<int>; else $$ = new List<Expr*>; }
           ;
 
-ExprList  :    ExprList ',' Expr    { ($$=$1)->Append($3); }
-          |    Expr                 { ($$ = new List<Expr*>)->Append($1); }
+ExprList  :    ExprList ',' Expr    { if (flat) ($<nodeList>$=$<nodeList>1)->Append($<node>3);
+                                      else ($$=$1)->Append($3); }
+          |    Expr                 { if (flat) ($<nodeList>$ = new List<int>)->Append($<node>1);
+                                      else ($$ = new List<Expr*>)->Append($1); }
           ;
 
-OptElse   :    T_Else Stmt          { $$ = $2; }
+OptElse   :    T_Else Stmt          { if (flat) $<node>$ = $<node>2; else $$ = $2; }
           |    /* empty */   %prec T_Lower_Than_Else 
-                                    { $$ = NULL; }
+                                    { if (flat) $<node>$ = FlatTree::None; else $$ = NULL; }
           ;
 
 %%
@@ -302,10 +370,61 @@ OptElse   :    T_Else Stmt          { $$ = $2; }
  * If set to false, no information is printed. Setting it to true will give
  * you a running trail that might be helpful when debugging your parser.
  * Please be sure the variable is set to false when submitting your final
- * version.
+ * version. It is shared by compilations running on other threads, so
+ * it is only written if it needs changing.
  */
 void InitParser()
 {
    PrintDebug("parser", "Initializing parser");
-   yydebug = false;
+   if (yydebug) yydebug = false;
+}
+
+
+/* Function: DumpTokens
+ * --------------------
+ * Scans the rest of the source and writes a line to out for each
+ * token, where it is and which it is, with the value of identifiers
+ * and constants, in place of parsing (-d tokens). Either scanner gives
+ * the same dump, which is how make scanner-check compares them.
+ */
+void DumpTokens(void *scanner, std::ostream& out)
+{
+    YYSTYPE value;
+    yyltype loc;
+    char line[64];
+    int token;
+    while ((token = yylex(&value, &loc, scanner)) != 0) {
+        sprintf(line, "line %d cols %d-%d is ", loc.first_line, loc.first_column,
+                loc.last_column);
+        out << line << yytname[YYTRANSLATE(token)];
+        switch (token) {
+          case T_Identifier: out << " (value = " << value.identifier << ")"; break;
+          case T_StringConstant: out << " (value = " << value.stringConstant << ")"; break;
+          case T_IntConstant: out << " (value = " << value.integerConstant << ")"; break;
+          case T_BoolConstant:
+            out << " (value = " << (value.boolConstant ? "true" : "false") << ")";
+            break;
+          case T_DoubleConstant:
+            sprintf(line, " (value = %.17g)", value.doubleConstant);
+            out << line;
+            break;
+        }
+        out << '\n';
+    }
+}
+
+/* Function: CountTokens
+ * ---------------------
+ * Scans the rest of the source without writing or parsing anything
+ * and returns the number of tokens (-d scan), so --time-report times
+ * the scanner alone, which is what make scanner-bench runs.
+ */
+int CountTokens(void *scanner)
+{
+    YYSTYPE value;
+    yyltype loc;
+    int count = 0;
+    while (yylex(&value, &loc, scanner) != 0)
+        count++;
+    return count;
 }
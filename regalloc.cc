@@ -0,0 +1,328 @@
+/* File: regalloc.cc
+ * -----------------
+ * Implementation of the global register allocators.
+ */
+
+#include "regalloc.h"
+#include "liveness.h"
+#include "tac.h"
+#include "utility.h"
+#include "timing.h"
+
+  // The registers handed out, in order of preference
+static const Mips::Register colors[] = {
+    Mips::t0, Mips::t1, Mips::t2, Mips::t3, Mips::t4,
+    Mips::t5, Mips::t6, Mips::t7, Mips::t8, Mips::t9,
+    Mips::s0, Mips::s1, Mips::s2, Mips::s3,
+    Mips::s4, Mips::s5, Mips::s6, Mips::s7 };
+static const int NumColors = sizeof(colors)/sizeof(colors[0]);
+static const unsigned AllColors = (1u << NumColors) - 1;
+
+  // Colors that do not survive a call: $t0-$t9, the first ten. The $s
+  // registers are saved and restored by any function that uses them.
+static const unsigned ClobberedByCall = (1u << 10) - 1;
+
+
+int RegisterAssignment::RegisterFor(Location *var) const
+{
+    std::map<Location*, int>::const_iterator found = regFor.find(var);
+    return (found == regFor.end()) ? -1 : found->second;
+}
+
+void RegisterAssignment::Assign(Location *var, Mips::Register reg)
+{
+    regFor[var] = reg;
+    used |= 1u << reg;
+}
+
+
+/* Function: IsCandidate
+ * ---------------------
+ * Only locals, temps and params can be kept in registers. Globals are
+ * visible to every function and so must stay in memory.
+ */
+static bool IsCandidate(Location *var)
+{
+    return var && var->GetSegment() == fpRelative && !var->IsReference();
+}
+
+int GraphColorAllocator::NodeFor(Location *var)
+{
+    std::map<Location*, int>::iterator found = nodeFor.find(var);
+    if (found != nodeFor.end())
+        return found->second;
+    Node n;
+    n.var = var;
+    n.forbidden = 0;
+    n.cost = 0;
+    n.color = -1;
+    nodes.push_back(n);
+    return nodeFor[var] = nodes.size() - 1;
+}
+
+void GraphColorAllocator::AddEdge(int a, int b)
+{
+    if (a == b || interferes[a][b]) return;
+    interferes[a][b] = interferes[b][a] = true;
+    nodes[a].adj.push_back(b);
+    nodes[b].adj.push_back(a);
+}
+
+
+/* Method: BuildGraph
+ * ------------------
+ * Every var written by an instruction interferes with everything live
+ * after it (except the source of a copy, which may share its register).
+ * Vars live on entry are all "written" by BeginFunc. Anything live
+ * across a call may not use a register the call clobbers. Costs are
+ * weighted by 10^depth, where depth counts the loops (back edges in
+ * the CFG) around the instruction.
+ */
+void GraphColorAllocator::BuildGraph(Liveness& live)
+{
+    for (int j = 0; j < cfg.num_instrs(); j++) {
+        Instruction *instr = cfg.instr(j);
+        Location *uses[3];
+        if (IsCandidate(instr->GetDef())) NodeFor(instr->GetDef());
+        for (int i = instr->GetUses(uses) - 1; i >= 0; i--)
+            if (IsCandidate(uses[i])) NodeFor(uses[i]);
+    }
+
+    std::vector<int> depth(cfg.num_blocks(), 0);
+    for (int b = 0; b < cfg.num_blocks(); b++)
+        for (const int *s = cfg.succ_begin(b); s != cfg.succ_end(b); ++s)
+            if (*s <= b)
+                for (int k = *s; k <= b; k++) depth[k]++;
+
+    interferes.assign(nodes.size(), std::vector<bool>(nodes.size(), false));
+    for (int j = 0; j < cfg.num_instrs(); j++) {
+        Instruction *instr = cfg.instr(j);
+        const LiveSet& out = live.LiveOut(j);
+        double weight = 1;
+        for (int d = 0; d < depth[cfg.block_containing(j)]; d++) weight *= 10;
+
+        Location *uses[3];
+        int numUses = instr->GetUses(uses);
+        for (int i = 0; i < numUses; i++)
+            if (IsCandidate(uses[i])) nodes[nodeFor[uses[i]]].cost += weight;
+
+        if (instr->GetOpcode() == Instruction::TacBeginFunc) {
+            for (int a = out.Next(0); a != -1; a = out.Next(a+1))
+                for (int b = out.Next(0); b != a; b = out.Next(b+1))
+                    if (IsCandidate(live.Var(a)) && IsCandidate(live.Var(b)))
+                        AddEdge(NodeFor(live.Var(a)), NodeFor(live.Var(b)));
+        }
+
+        Location *def = instr->GetDef();
+        if (IsCandidate(def)) {
+            int d = nodeFor[def];
+            nodes[d].cost += weight;
+            Location *copied = (instr->GetOpcode() == Instruction::TacAssign) ?
+                               instr->GetUse(0) : NULL;
+            for (int v = out.Next(0); v != -1; v = out.Next(v+1)) {
+                Location *l = live.Var(v);
+                if (IsCandidate(l) && l != def && l != copied)
+                    AddEdge(d, nodeFor[l]);
+            }
+        }
+
+        if (instr->IsCall()) {
+            for (int v = out.Next(0); v != -1; v = out.Next(v+1))
+                if (IsCandidate(live.Var(v)) && live.Var(v) != def)
+                    nodes[nodeFor[live.Var(v)]].forbidden |= ClobberedByCall;
+        }
+    }
+}
+
+
+/* Method: Color
+ * -------------
+ * Simplify: repeatedly remove a node that is sure to be colorable
+ * (fewer neighbors than free colors); when there is none, optimistically
+ * remove the cheapest node to spill (cost/degree). Select: color the
+ * nodes in reverse order of removal, spilling any that find no color.
+ */
+void GraphColorAllocator::Color()
+{
+    int n = nodes.size();
+    std::vector<int> degree(n), stack;
+    std::vector<bool> removed(n, false);
+    for (int i = 0; i < n; i++) {
+        degree[i] = nodes[i].adj.size();
+        if (nodes[i].forbidden == AllColors) // no register will do
+            removed[i] = true;
+    }
+    for (int i = 0; i < n; i++)
+        if (removed[i])
+            for (int a = 0; a < nodes[i].adj.size(); a++) degree[nodes[i].adj[a]]--;
+
+    while (true) {
+        int pick = -1, spill = -1;
+        for (int i = 0; i < n && pick == -1; i++) {
+            if (removed[i]) continue;
+            int free = NumColors;
+            for (int c = 0; c < NumColors; c++)
+                if (nodes[i].forbidden & (1u << c)) free--;
+            if (degree[i] < free)
+                pick = i;
+            else if (spill == -1 || nodes[i].cost * degree[spill] < nodes[spill].cost * degree[i])
+                spill = i;
+        }
+        if (pick == -1) pick = spill;
+        if (pick == -1) break;
+        removed[pick] = true;
+        stack.push_back(pick);
+        for (int a = 0; a < nodes[pick].adj.size(); a++) degree[nodes[pick].adj[a]]--;
+    }
+
+    while (!stack.empty()) {
+        Node& node = nodes[stack.back()];
+        stack.pop_back();
+        unsigned used = node.forbidden;
+        for (int a = 0; a < node.adj.size(); a++)
+            if (nodes[node.adj[a]].color != -1)
+                used |= 1u << nodes[node.adj[a]].color;
+        for (int c = 0; c < NumColors && node.color == -1; c++)
+            if (!(used & (1u << c)))
+                node.color = c;
+    }
+}
+
+
+void GraphColorAllocator::Allocate(RegisterAssignment *result)
+{
+    BeginPhase(DataflowPhase);
+    Liveness live(cfg);
+    EndPhase(DataflowPhase);
+    BuildGraph(live);
+    Color();
+
+    for (int i = 0; i < nodes.size(); i++) {
+        if (nodes[i].color != -1)
+            result->Assign(nodes[i].var, colors[nodes[i].color]);
+        PrintDebug("regalloc", "%s: %s (cost %g, degree %d)", nodes[i].var->GetName(),
+                   nodes[i].color == -1 ? "spilled" : "register", nodes[i].cost,
+                   (int)nodes[i].adj.size());
+    }
+    const LiveSet& entry = live.LiveOut(0); // after BeginFunc
+    for (int i = 0; i < nodes.size(); i++)
+        if (nodes[i].color != -1 && entry.Contains(live.IndexOf(nodes[i].var)))
+            result->AddLiveOnEntry(nodes[i].var);
+}
+
+
+void LinearScanAllocator::Extend(Location *var, int index)
+{
+    if (!IsCandidate(var)) return;
+    std::map<Location*, int>::iterator found = intervalFor.find(var);
+    if (found == intervalFor.end()) {
+        Interval i;
+        i.var = var;
+        i.start = i.end = index;
+        i.forbidden = 0;
+        i.color = -1;
+        intervals.push_back(i);
+        intervalFor[var] = intervals.size() - 1;
+    } else {
+        Interval& i = intervals[found->second];
+        if (index < i.start) i.start = index;
+        if (index > i.end) i.end = index;
+    }
+}
+
+
+/* Method: BuildIntervals
+ * ----------------------
+ * A var's interval runs from the first to the last instruction where
+ * it is live or touched, numbering instructions in list order. That is
+ * all positions between, so a var live around a loop covers the loop.
+ * Intervals are collected in order of increasing start.
+ */
+void LinearScanAllocator::BuildIntervals(Liveness& live)
+{
+    for (int index = 0; index < cfg.num_instrs(); index++) {
+        Instruction *instr = cfg.instr(index);
+        const LiveSet& in = live.LiveIn(index);
+        for (int v = in.Next(0); v != -1; v = in.Next(v+1))
+            Extend(live.Var(v), index);
+        const LiveSet& out = live.LiveOut(index);
+        for (int v = out.Next(0); v != -1; v = out.Next(v+1))
+            Extend(live.Var(v), index);
+        Location *uses[3];
+        for (int i = instr->GetUses(uses) - 1; i >= 0; i--)
+            Extend(uses[i], index);
+        Extend(instr->GetDef(), index);
+
+        if (instr->IsCall())
+            for (int v = out.Next(0); v != -1; v = out.Next(v+1))
+                if (IsCandidate(live.Var(v)) && live.Var(v) != instr->GetDef())
+                    intervals[intervalFor[live.Var(v)]].forbidden |= ClobberedByCall;
+    }
+}
+
+
+/* Method: Scan
+ * ------------
+ * Walks the intervals by start, keeping the active ones (those holding
+ * a register) ordered by end. Intervals that ended free their register
+ * first; when none is left, whichever of the current interval and the
+ * active ones ends last is spilled to memory for its whole lifetime.
+ */
+void LinearScanAllocator::Scan()
+{
+    std::vector<int> active; // indices into intervals, sorted by end
+    unsigned inUse = 0;
+    for (int cur = 0; cur < intervals.size(); cur++) {
+        Interval& i = intervals[cur];
+        while (!active.empty() && intervals[active.front()].end < i.start) {
+            inUse &= ~(1u << intervals[active.front()].color);
+            active.erase(active.begin());
+        }
+        if (i.forbidden == AllColors) continue;
+
+        unsigned avail = AllColors & ~inUse & ~i.forbidden;
+        if (!avail) {
+            int victim = -1; // only one not barred from i's colors will do
+            for (int a = active.size() - 1; a >= 0 && victim == -1; a--)
+                if (!(i.forbidden & (1u << intervals[active[a]].color)))
+                    victim = a;
+            if (victim == -1 || intervals[active[victim]].end <= i.end)
+                continue; // i is spilled
+            Interval& spilled = intervals[active[victim]];
+            i.color = spilled.color;
+            spilled.color = -1;
+            active.erase(active.begin() + victim);
+        } else {
+            for (i.color = 0; !(avail & (1u << i.color)); i.color++)
+                ;
+            inUse |= 1u << i.color;
+        }
+        int pos = active.size();
+        while (pos > 0 && intervals[active[pos-1]].end > i.end) pos--;
+        active.insert(active.begin() + pos, cur);
+    }
+}
+
+
+void LinearScanAllocator::Allocate(RegisterAssignment *result)
+{
+    BeginPhase(DataflowPhase);
+    Liveness live(cfg);
+    EndPhase(DataflowPhase);
+    BuildIntervals(live);
+    Scan();
+
+    const LiveSet& entry = live.LiveOut(0); // after BeginFunc
+    for (int i = 0; i < intervals.size(); i++) {
+        if (intervals[i].color == -1) {
+            PrintDebug("regalloc", "%s: spilled [%d,%d]", intervals[i].var->GetName(),
+                       intervals[i].start, intervals[i].end);
+            continue;
+        }
+        result->Assign(intervals[i].var, colors[intervals[i].color]);
+        PrintDebug("regalloc", "%s: register [%d,%d]", intervals[i].var->GetName(),
+                   intervals[i].start, intervals[i].end);
+        if (entry.Contains(live.IndexOf(intervals[i].var)))
+            result->AddLiveOnEntry(intervals[i].var);
+    }
+}
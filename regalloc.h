@@ -0,0 +1,122 @@
+/* File: regalloc.h
+ * ----------------
+ * Global register allocation for one function at a time. The result
+ * is a RegisterAssignment that tells Mips which register holds each
+ * local/temp for the whole function body; anything without a register
+ * (globals, spilled vars) is loaded and stored around each use through
+ * the scratch registers $a0, $a1 and $v1, which are never handed out.
+ * Vars live across a call only get $s registers, which the functions
+ * using them save and restore, since every call clobbers the $t ones.
+ *
+ * GraphColorAllocator (-O2) is a Chaitin/Briggs style allocator: it
+ * builds an interference graph from live variable analysis over the
+ * CFG, colors it optimistically onto $t0-$t9/$s0-$s7 and spills the
+ * nodes it could not color, preferring those with the lowest
+ * loop-weighted use count.
+ *
+ * LinearScanAllocator (-O1) is the cheaper Poletto/Sarkar linear scan:
+ * each var gets one live interval over the instruction order, and the
+ * intervals are handed registers in order of start, spilling the one
+ * that reaches furthest when registers run out. No graph is built.
+ */
+
+#ifndef _H_regalloc
+#define _H_regalloc
+
+#include <map>
+#include <vector>
+#include "list.h"
+#include "cfg.h"
+#include "mips.h"
+class Location;
+class Liveness;
+
+
+class RegisterAssignment
+{
+  protected:
+    std::map<Location*, int> regFor;
+    List<Location*> liveOnEntry;
+    unsigned used;  // bit per Mips::Register handed out
+
+  public:
+    RegisterAssignment() : used(0) {}
+
+          // Returns the register (a Mips::Register) assigned to var, or
+          // -1 if var lives in memory.
+    int RegisterFor(Location *var) const;
+    void Assign(Location *var, Mips::Register reg);
+
+          // Whether any var was given reg (general purpose registers only)
+    bool Uses(Mips::Register reg) const { return used & (1u << reg); }
+
+          // Vars with a register that already hold a value when the
+          // function starts (params, and locals read before written)
+    const List<Location*>& LiveOnEntry() const { return liveOnEntry; }
+    void AddLiveOnEntry(Location *var) { liveOnEntry.Append(var); }
+};
+
+
+class RegisterAllocator
+{
+  public:
+    RegisterAllocator(ControlFlowGraph& cfg) : cfg(cfg) {}
+    virtual ~RegisterAllocator() {}
+
+          // Fills in result with registers for the function's vars
+    virtual void Allocate(RegisterAssignment *result) = 0;
+
+  protected:
+    ControlFlowGraph& cfg;
+};
+
+
+class GraphColorAllocator : public RegisterAllocator
+{
+  public:
+    GraphColorAllocator(ControlFlowGraph& cfg) : RegisterAllocator(cfg) {}
+    void Allocate(RegisterAssignment *result);
+
+  private:
+    struct Node {
+        Location *var;
+        std::vector<int> adj;
+        unsigned forbidden;  // bit per color that may not be used
+        double cost;         // loop-weighted count of defs and uses
+        int color;
+    };
+
+    std::vector<Node> nodes;
+    std::map<Location*, int> nodeFor;
+    std::vector<std::vector<bool> > interferes;
+
+    int NodeFor(Location *var);
+    void AddEdge(int a, int b);
+    void BuildGraph(Liveness& live);
+    void Color();
+};
+
+
+class LinearScanAllocator : public RegisterAllocator
+{
+  public:
+    LinearScanAllocator(ControlFlowGraph& cfg) : RegisterAllocator(cfg) {}
+    void Allocate(RegisterAssignment *result);
+
+  private:
+    struct Interval {
+        Location *var;
+        int start, end;       // instruction indices, inclusive
+        unsigned forbidden;   // bit per color that may not be used
+        int color;
+    };
+
+    std::vector<Interval> intervals;
+    std::map<Location*, int> intervalFor;
+
+    void Extend(Location *var, int index);
+    void BuildIntervals(Liveness& live);
+    void Scan();
+};
+
+#endif
@@ -3,23 +3,33 @@
  * You should not need to modify this file. It declare a few constants,
  * types, variables,and functions that are used and/or exported by
  * the lex-generated scanner.
+ *
+ * The scanner is reentrant: InitScanner sets one up to read a source
+ * buffer and everything it keeps between tokens lives with it, so the
+ * parser passes it along to each call of yylex. It scans the buffer in
+ * place rather than copying it, so the buffer must be writable and
+ * have two nuls after its length chars (see sourcefile.h).
  */
 
 #ifndef _H_scanner
 #define _H_scanner
 
-#include <stdio.h>
+#include <string>
+#include "location.h"
 
 #define MaxIdentLen 31    // Maximum length for identifiers
 
-extern char *yytext;      // Text of lexeme just scanned
+union YYSTYPE;
 
 
-int yylex();              // Defined in the generated lex.yy.c file
-void yyrestart(FILE *fp); // ditto
+          // The scanner is a flex yyscan_t, which is a void *
+void *InitScanner(char *source, int length); // Defined in scanner.l user subroutines
+void FreeScanner(void *scanner);             // ditto
+void RestoreSource(void *scanner);           // ditto, put the source back as it was
+void TerminateToken(void *scanner);          //   and as the scanner wants it
+int yylex(union YYSTYPE *yylval, yyltype *yylloc, void *scanner); // Defined in the generated lex.yy.c file
 
-
-void InitScanner();                 // Defined in scanner.l user subroutines
-const char *GetLineNumbered(int n); // ditto
+          // Line n of the source of the current compilation, see compilation.h
+bool GetLineNumbered(int n, std::string *line);
  
 #endif
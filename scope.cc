@@ -13,17 +13,27 @@
 Scope::Scope()
 {
     table = new Hashtable<Decl*>;
+    inherited = NULL;
 }
 
 
 /* Method: Lookup
  * --------------
- * Looks for an identifier in this scope only. Returns NULL if
- * not found.
+ * Looks for an identifier in this scope and the ones it inherits
+ * from. Returns NULL if not found.
  */
 Decl *Scope::Lookup(Identifier *id)       
 {
-    return table->Lookup(id->GetName());
+    return Lookup(id->GetName());
+}
+
+Decl *Scope::Lookup(const char *name)
+{
+    for (Scope *s = this; s; s = s->inherited) {
+        Decl *found = s->table->Lookup(name);
+        if (found) return found;
+    }
+    return NULL;
 }
 
 
@@ -31,11 +41,12 @@ Decl *Scope::Lookup(Identifier *id)
  * ---------------
  * Adds an identifier to this scope and sets scope on declaration.
  * Prints error if declaration/definition conflicts with use of identifier
- * in this scope and returns false. If successful, returns true.
+ * in this scope (an inherited one included, unless it is a proper
+ * override) and returns false. If successful, returns true.
  */
 bool Scope::Declare(Decl *decl)
 {
-  Decl *prev = table->Lookup(decl->GetName());
+  Decl *prev = Lookup(decl->GetId());
   PrintDebug("scope", "Line %d declaring %s (prev? %p)\n", decl->GetLocation()->first_line, decl->GetName(), prev);
   if (prev && decl->ConflictsWithPrevious(prev)) // throw away second, keep first
       return false;
@@ -43,13 +54,64 @@ bool Scope::Declare(Decl *decl)
   return true;
 }
 
-void Scope::CopyFromScope(Scope *other, ClassDecl *addTo)
+
+
+/* Method: Push
+ * ------------
+ * Makes each decl in the scope visible. The binding it hides is
+ * kept in the new one, so Pop can put it back. What the scope
+ * inherits is not pushed, see Lookup.
+ */
+void ScopeStack::Push(Scope *s)
 {
-    Iterator<Decl*> iter = other->table->GetIterator();
+    Layer l;
+    l.scope = s;
+    l.mark = bindings.size();
+    layers.push_back(l);
+    Iterator<Decl*> iter = s->GetIterator();
     Decl *decl;
     while ((decl = iter.GetNextValue()) != NULL) {
-        table->Enter(decl->GetName(), decl);
-	  if (addTo) addTo->AddField(decl);
+        Binding b;
+        b.symbol = SymbolId(decl->GetName());
+        b.decl = decl;
+        if (b.symbol >= (int)innermost.size())
+            innermost.resize(NumSymbols(), -1);
+        b.hidden = innermost[b.symbol];
+        innermost[b.symbol] = bindings.size();
+        bindings.push_back(b);
+    }
+}
+
+void ScopeStack::Pop()
+{
+    Assert(!layers.empty());
+    while ((int)bindings.size() > layers.back().mark) {
+        innermost[bindings.back().symbol] = bindings.back().hidden;
+        bindings.pop_back();
     }
+    layers.pop_back();
+}
+
+/* Method: Lookup
+ * --------------
+ * The innermost binding wins, unless a scope pushed after it inherits
+ * a decl of the same name (an inherited member hides a global), so
+ * the layers above the binding found are asked for inherited decls.
+ * Only class scopes inherit anything.
+ */
+Decl *ScopeStack::Lookup(Identifier *id)
+{
+    return Lookup(id->GetName());
 }
 
+Decl *ScopeStack::Lookup(const char *name)
+{
+    int symbol = SymbolId(name);
+    int found = (symbol < (int)innermost.size()) ? innermost[symbol] : -1;
+    for (int i = layers.size() - 1; i >= 0 && layers[i].mark > found; i--) {
+        Scope *inherited = layers[i].scope->GetInherited();
+        Decl *decl = inherited ? inherited->Lookup(name) : NULL;
+        if (decl) return decl;
+    }
+    return (found == -1) ? NULL : bindings[found].decl;
+}
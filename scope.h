@@ -2,27 +2,69 @@
  * -------------
  * The Scope class will be used to manage scopes, sort of
  * table used to map identifier names to Declaration objects.
+ * A class scope holds just the members the class declares itself and
+ * inherits the rest from its parent class's scope, which it searches
+ * after its own. The parent's scope is shared by all its subclasses,
+ * never copied into them.
+ *
+ * The ScopeStack is used by the binding pass (see Node::Bind) to
+ * resolve names against all the scopes open at some point in the
+ * tree at once: each name maps straight to its innermost visible
+ * declaration, so a lookup costs the same however deeply the scopes
+ * are nested.
  */
 
 #ifndef _H_scope
 #define _H_scope
 
+#include <vector>
 #include "hashtable.h"
 
 class Decl;
 class Identifier;
-class ClassDecl; 
 
 class Scope { 
   protected:
     Hashtable<Decl*> *table;
+    Scope *inherited;   // searched after table, NULL if none
 
   public:
     Scope();
+    ~Scope() { delete table; }
 
     Decl *Lookup(Identifier *id);
+    Decl *Lookup(const char *name);     // name interned
     bool Declare(Decl *dec);
-    void CopyFromScope(Scope *other, ClassDecl *cd);
+    void InheritFrom(Scope *s) { inherited = s; }
+    Scope *GetInherited() { return inherited; }
+          // Visits only the decls made in this scope, not inherited ones
+    Iterator<Decl*> GetIterator() { return table->GetIterator(); }
+};
+
+
+class ScopeStack {
+  protected:
+    struct Binding {
+        int symbol;   // id of the name, see intern.h
+        Decl *decl;
+        int hidden;   // binding this one hides, -1 if none
+    };
+    std::vector<Binding> bindings;   // all visible, innermost scope last
+    std::vector<int> innermost;      // binding per symbol id, -1 if none
+    struct Layer {
+        Scope *scope;
+        int mark;     // bindings.size() when pushed
+    };
+    std::vector<Layer> layers;
+
+  public:
+          // Opens s on top of the stack, hiding outer decls of the same names
+    void Push(Scope *s);
+          // Closes the scope last pushed, uncovering what it hid
+    void Pop();
+          // Innermost decl visible for id, NULL if none
+    Decl *Lookup(Identifier *id);
+    Decl *Lookup(const char *name);     // name interned
 };
 
 
@@ -0,0 +1,66 @@
+/* File: sourcefile.cc
+ * -------------------
+ * Implementation of SourceFile.
+ */
+
+#include "sourcefile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::~SourceFile()
+{
+    if (mapped) munmap(text, mapped);
+}
+
+/* Method: Map
+ * -----------
+ * Maps zeroed pages for the file plus the two nuls and then the file
+ * over the front of them. The rest of the file's last page reads as
+ * zeros too, so the nuls are there whether or not the file ends on a
+ * page boundary. Pipes and the like can't be mapped and are read.
+ */
+bool SourceFile::Map(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0) return false;
+    if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode)) {
+        FILE *f = fdopen(fd, "rb");
+        bool ok = f && Read(f);
+        if (f) fclose(f); else close(fd);
+        return ok;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (info.st_size + 2 + page - 1) / page * page;
+    void *span = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (span != MAP_FAILED && info.st_size > 0
+        && mmap(span, info.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int error = errno;
+        munmap(span, size);
+        errno = error;
+        span = MAP_FAILED;
+    }
+    close(fd);
+    if (span == MAP_FAILED) return false;
+    text = (char *)span;
+    length = info.st_size;
+    mapped = size;
+    return true;
+}
+
+bool SourceFile::Read(FILE *f)
+{
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        contents.append(buf, n);
+    if (ferror(f)) return false;
+    length = contents.size();
+    contents.append(2, '\0');
+    text = &contents[0];
+    return true;
+}
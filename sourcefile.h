@@ -0,0 +1,45 @@
+/* File: sourcefile.h
+ * ------------------
+ * The text of the program dcc compiles, held the way the scanner wants
+ * it: writable (the scanner ends each token's text by writing a nul
+ * after it, putting the char back when it moves on) and followed by
+ * two nuls. A file named on the command line is mapped into memory
+ * rather than read, so the scanner works in the page cache and only
+ * the pages it writes to get a private copy. Standard input can't be
+ * mapped and is read into memory instead.
+ *
+ *   SourceFile source;
+ *   if (!source.Map("prog.decaf")) ...;
+ *   compilation.RunInPlace(source.Text(), source.Length());
+ */
+
+#ifndef _H_sourcefile
+#define _H_sourcefile
+
+#include <stdio.h>
+#include <string>
+
+class SourceFile
+{
+  public:
+    SourceFile() : text(NULL), length(0), mapped(0) {}
+    ~SourceFile();
+
+          // Each returns false, with errno set, if the text can't be had
+    bool Map(const char *path);
+    bool Read(FILE *f);
+
+    char *Text()                  { return text; }
+    int Length()                  { return length; }
+
+  private:
+    char *text;
+    size_t length;
+    size_t mapped;      // bytes mapped at text, 0 if text is in contents
+    std::string contents;
+
+    SourceFile(const SourceFile&);   // not copyable
+    void operator=(const SourceFile&);
+};
+
+#endif
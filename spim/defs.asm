@@ -112,6 +112,7 @@ _Halt:
         syscall
 
 _ReadInteger:
+	subu $sp, $sp, 8      # decrement sp to make space to save ra, fp
 	sw $fp, 8($sp)        # save fp
 	sw $ra, 4($sp)        # save ra
 	addiu $fp, $sp, 8     # set up new fp
@@ -125,6 +126,7 @@ _ReadInteger:
         
 
 _ReadLine:
+	subu $sp, $sp, 8      # decrement sp to make space to save ra, fp
 	sw $fp, 8($sp)        # save fp
 	sw $ra, 4($sp)        # save ra
 	addiu $fp, $sp, 8     # set up new fp
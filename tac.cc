@@ -5,119 +5,135 @@
   
 #include "tac.h"
 #include "mips.h"
+#include "compilation.h"
 #include <cstring>
 
 Location::Location(Segment s, int o, const char *name) :
-  variableName(strdup(name)), segment(s), offset(o), base(NULL) , refOffset(0),isReference(false)
+  variableName(name), segment(s), offset(o), base(NULL) , refOffset(0),isReference(false)
 {
 
 }
 
  
+Instruction::Instruction(Opcode op, Location *d, Location *use0, Location *use1)
+  : def(d), label(NULL), imm(0), opcode(op), numUses(0) {
+  if (use0) uses[numUses++] = use0;
+  if (use1) uses[numUses++] = use1;
+}
+
+int Instruction::GetUses(Location *out[]) const {
+  for (int i = 0; i < numUses; i++)
+    out[i] = uses[i];
+  return numUses;
+}
+
 void Instruction::Print() {
-  printf("\t%s ;\n", printed);
+  char text[MaxTextLength];
+  Format(text);
+  Compilation::Current()->Output() << "\t" << text << " ;\n";
 }
 
 void Instruction::Emit(Mips *mips) {
   Mips::CurrentInstruction ci(*mips, this);
-  if (*printed)
-    mips->Emit("# %s", printed);   // emit TAC as comment into assembly
+  if (!LeanAssembly()) {
+    char text[MaxTextLength];
+    Format(text);
+    if (*text)
+      mips->Emit("# %s", text);   // emit TAC as comment into assembly
+  }
   EmitSpecific(mips);
 } 
 
 DiscardValue::DiscardValue(Location *d)
-  : dst(d) {
-  Assert(dst != NULL);
-  //sprintf(printed, "Last use of %s.", dst->GetName());
+  : Instruction(TacDiscardValue, NULL, d) {
+  Assert(d != NULL);
 }
 
 void DiscardValue::EmitSpecific(Mips *mips) {
-  mips->EmitDiscardValue(dst);
+  mips->EmitDiscardValue(uses[0]);
 }
 
 LoadConstant::LoadConstant(Location *d, int v)
-  : dst(d), val(v) {
-  Assert(dst != NULL);
-  sprintf(printed, "%s = %d", dst->GetName(), val);
-  numVars = 1;
-  varA = d;
+  : Instruction(TacLoadConstant, d) {
+  Assert(def != NULL);
+  imm = v;
+}
+void LoadConstant::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s = %d", def->GetName(), imm);
 }
 void LoadConstant::EmitSpecific(Mips *mips) {
-  mips->EmitLoadConstant(dst, val);
+  mips->EmitLoadConstant(def, imm);
 }
 
 
 LoadStringConstant::LoadStringConstant(Location *d, const char *s)
-  : dst(d) {
-  Assert(dst != NULL && s != NULL);
-  const char *quote = (*s == '"') ? "" : "\"";
-  str = new char[strlen(s) + 2*strlen(quote) + 1];
-  sprintf(str, "%s%s%s", quote, s, quote);
-  quote = (strlen(str) > 50) ? "...\"" : "";
-  sprintf(printed, "%s = %.50s%s", dst->GetName(), str, quote);
-  numVars = 1;
-  varA = d;
+  : Instruction(TacLoadStringConstant, d) {
+  Assert(def != NULL && s != NULL && *s == '"');
+  label = s;
+}
+void LoadStringConstant::Format(char *buf) const {
+  const char *quote = (strlen(label) > 50) ? "...\"" : "";
+  snprintf(buf, MaxTextLength, "%s = %.50s%s", def->GetName(), label, quote);
 }
 void LoadStringConstant::EmitSpecific(Mips *mips) {
-  mips->EmitLoadStringConstant(dst, str);
+  mips->EmitLoadStringConstant(def, label);
 }
      
 
 LoadLabel::LoadLabel(Location *d, const char *l)
-  : dst(d), label(strdup(l)) {
-  Assert(dst != NULL && label != NULL);
-  sprintf(printed, "%s = %s", dst->GetName(), label);
-  numVars = 1;
-  varA = d;
+  : Instruction(TacLoadLabel, d) {
+  Assert(def != NULL && l != NULL);
+  label = l;
+}
+void LoadLabel::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s = %s", def->GetName(), label);
 }
 void LoadLabel::EmitSpecific(Mips *mips) {
-  mips->EmitLoadLabel(dst, label);
+  mips->EmitLoadLabel(def, label);
 }
 
 
 Assign::Assign(Location *d, Location *s)
-  : dst(d), src(s) {
-  Assert(dst != NULL && src != NULL);
-  sprintf(printed, "%s = %s", dst->GetName(), src->GetName());
-  numVars = 2;
-  varA = d;
-  varB = s;
-  
+  : Instruction(TacAssign, d, s) {
+  Assert(d != NULL && s != NULL);
+}
+void Assign::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s = %s", def->GetName(), uses[0]->GetName());
 }
 void Assign::EmitSpecific(Mips *mips) {
-  mips->EmitCopy(dst, src);
+  mips->EmitCopy(def, uses[0]);
 }
 
 
 Load::Load(Location *d, Location *s, int off)
-  : dst(d), src(s), offset(off) {
-  Assert(dst != NULL && src != NULL);
-  if (offset) 
-    sprintf(printed, "%s = *(%s + %d)", dst->GetName(), src->GetName(), offset);
+  : Instruction(TacLoad, d, s) {
+  Assert(d != NULL && s != NULL);
+  imm = off;
+}
+void Load::Format(char *buf) const {
+  if (imm) 
+    snprintf(buf, MaxTextLength, "%s = *(%s + %d)", def->GetName(), uses[0]->GetName(), imm);
   else
-    sprintf(printed, "%s = *(%s)", dst->GetName(), src->GetName());
-  numVars = 2;
-  varA = d;
-  varB = s;
+    snprintf(buf, MaxTextLength, "%s = *(%s)", def->GetName(), uses[0]->GetName());
 }
 void Load::EmitSpecific(Mips *mips) {
-  mips->EmitLoad(dst, src, offset);
+  mips->EmitLoad(def, uses[0], imm);
 }
 
 
 Store::Store(Location *d, Location *s, int off)
-  : dst(d), src(s), offset(off) {
-  Assert(dst != NULL && src != NULL);
-  if (offset)
-    sprintf(printed, "*(%s + %d) = %s", dst->GetName(), offset, src->GetName());
+  : Instruction(TacStore, NULL, d, s) {
+  Assert(d != NULL && s != NULL);
+  imm = off;
+}
+void Store::Format(char *buf) const {
+  if (imm)
+    snprintf(buf, MaxTextLength, "*(%s + %d) = %s", uses[0]->GetName(), imm, uses[1]->GetName());
   else
-    sprintf(printed, "*(%s) = %s", dst->GetName(), src->GetName());
-  numVars = 2;
-  varA = d;
-  varB = s;
+    snprintf(buf, MaxTextLength, "*(%s) = %s", uses[0]->GetName(), uses[1]->GetName());
 }
 void Store::EmitSpecific(Mips *mips) {
-  mips->EmitStore(dst, src, offset);
+  mips->EmitStore(uses[0], uses[1], imm);
 }
 
  
@@ -132,135 +148,150 @@ BinaryOp::OpCode BinaryOp::OpCodeForName(const char *name) {
 }
 
 BinaryOp::BinaryOp(OpCode c, Location *d, Location *o1, Location *o2)
-  : code(c), dst(d), op1(o1), op2(o2) {
-  Assert(dst != NULL && op1 != NULL && op2 != NULL);
-  Assert(code >= 0 && code < NumOps);
-  sprintf(printed, "%s = %s %s %s", dst->GetName(), op1->GetName(), opName[code], op2->GetName());
-  numVars = 3;
-  varA = d;
-  varB = o1;
-  varC = o2;
+  : Instruction(TacBinaryOp, d, o1, o2) {
+  Assert(d != NULL && o1 != NULL && o2 != NULL);
+  Assert(c >= 0 && c < NumOps);
+  imm = c;
+}
+void BinaryOp::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s = %s %s %s", def->GetName(), uses[0]->GetName(),
+           opName[imm], uses[1]->GetName());
 }
 void BinaryOp::EmitSpecific(Mips *mips) {	  
-  mips->EmitBinaryOp(code, dst, op1, op2);
+  mips->EmitBinaryOp((OpCode)imm, def, uses[0], uses[1]);
 }
 
-Label::Label(const char *l) : label(strdup(l)) {
-  Assert(label != NULL);
-  *printed = '\0';
+Label::Label(const char *l) : Instruction(TacLabel) {
+  Assert(l != NULL);
+  label = l;
 }
 void Label::Print() {
-  printf("%s:\n", label);
+  Compilation::Current()->Output() << label << ":\n";
 }
 void Label::EmitSpecific(Mips *mips) {
   mips->EmitLabel(label);
 }
  
-Goto::Goto(const char *l) : label(strdup(l)) {
-  Assert(label != NULL);
-  sprintf(printed, "Goto %s", label);
+Goto::Goto(const char *l) : Instruction(TacGoto) {
+  Assert(l != NULL);
+  label = l;
+}
+void Goto::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "Goto %s", label);
 }
 void Goto::EmitSpecific(Mips *mips) {	  
   mips->EmitGoto(label);
 }
 
 IfZ::IfZ(Location *te, const char *l)
-   : test(te), label(strdup(l)) {
-  Assert(test != NULL && label != NULL);
-  sprintf(printed, "IfZ %s Goto %s", test->GetName(), label);
-  numVars = 1;
-  varA = te;
+   : Instruction(TacIfZ, NULL, te) {
+  Assert(te != NULL && l != NULL);
+  label = l;
+}
+void IfZ::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "IfZ %s Goto %s", uses[0]->GetName(), label);
 }
 void IfZ::EmitSpecific(Mips *mips) {	  
-  mips->EmitIfZ(test, label);
+  mips->EmitIfZ(uses[0], label);
 }
 
-BeginFunc::BeginFunc() {
-  sprintf(printed,"BeginFunc (unassigned)");
-  frameSize = -555; // used as sentinel to recognized unassigned value
+BeginFunc::BeginFunc() : Instruction(TacBeginFunc) {
+  imm = -555; // used as sentinel to recognized unassigned value
 }
 void BeginFunc::SetFrameSize(int numBytesForAllLocalsAndTemps) {
-  frameSize = numBytesForAllLocalsAndTemps; 
-  sprintf(printed,"BeginFunc %d", frameSize);
+  imm = numBytesForAllLocalsAndTemps; 
+}
+void BeginFunc::Format(char *buf) const {
+  if (imm == -555)
+    snprintf(buf, MaxTextLength, "BeginFunc (unassigned)");
+  else
+    snprintf(buf, MaxTextLength, "BeginFunc %d", imm);
 }
 void BeginFunc::EmitSpecific(Mips *mips) {
-  mips->EmitBeginFunction(frameSize);
+  mips->EmitBeginFunction(imm);
 }
 
-EndFunc::EndFunc() : Instruction() {
-  sprintf(printed, "EndFunc");
+EndFunc::EndFunc() : Instruction(TacEndFunc) {
+}
+void EndFunc::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "EndFunc");
 }
 void EndFunc::EmitSpecific(Mips *mips) {
   mips->EmitEndFunction();
 }
  
-Return::Return(Location *v) : val(v) {
-  sprintf(printed, "Return %s", val? val->GetName() : "");
-  numVars = 1;
-  varA = v;
+Return::Return(Location *v) : Instruction(TacReturn, NULL, v) {
+}
+void Return::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "Return %s", numUses? uses[0]->GetName() : "");
 }
 void Return::EmitSpecific(Mips *mips) {	  
-  mips->EmitReturn(val);
+  mips->EmitReturn(numUses? uses[0] : NULL);
 }
 
 PushParam::PushParam(Location *p)
-  :  param(p) {
-  Assert(param != NULL);
-  sprintf(printed, "PushParam %s", param->GetName());
-  numVars = 1;
-  varA = p;
+  :  Instruction(TacPushParam, NULL, p) {
+  Assert(p != NULL);
+}
+void PushParam::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "PushParam %s", uses[0]->GetName());
 }
 void PushParam::EmitSpecific(Mips *mips) {
-  mips->EmitParam(param);
+  mips->EmitParam(uses[0]);
 } 
 
 PopParams::PopParams(int nb)
-  :  numBytes(nb) {
-  sprintf(printed, "PopParams %d", numBytes);
+  :  Instruction(TacPopParams) {
+  imm = nb;
+}
+void PopParams::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "PopParams %d", imm);
 }
 void PopParams::EmitSpecific(Mips *mips) {
-  mips->EmitPopParams(numBytes);
+  mips->EmitPopParams(imm);
 } 
 
 
 LCall::LCall(const char *l, Location *d)
-  :  label(strdup(l)), dst(d) {
-  sprintf(printed, "%s%sLCall %s", dst? dst->GetName(): "", dst?" = ":"", label);
-  if (dst) {
-      numVars = 1;
-      varA = d;
-  }
+  :  Instruction(TacLCall, d) {
+  label = l;
+}
+void LCall::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s%sLCall %s", def? def->GetName(): "", def?" = ":"", label);
 }
 void LCall::EmitSpecific(Mips *mips) {
-  mips->EmitLCall(dst, label);
+  mips->EmitLCall(def, label);
 }
 
 ACall::ACall(Location *ma, Location *d)
-  : dst(d), methodAddr(ma) {
-  Assert(methodAddr != NULL);
-  sprintf(printed, "%s%sACall %s", dst? dst->GetName(): "", dst?" = ":"",
-	    methodAddr->GetName());
-  if (dst) {
-      numVars = 1;
-      varA = d;
-  }
+  : Instruction(TacACall, d, ma) {
+  Assert(ma != NULL);
+}
+void ACall::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "%s%sACall %s", def? def->GetName(): "", def?" = ":"",
+	    uses[0]->GetName());
 }
 void ACall::EmitSpecific(Mips *mips) {
-  mips->EmitACall(dst, methodAddr);
+  mips->EmitACall(def, uses[0]);
 } 
 
-VTable::VTable(const char *l, List<const char *> *m)
-  : methodLabels(m), label(strdup(l)) {
-  Assert(methodLabels != NULL && label != NULL);
-  sprintf(printed, "VTable for class %s", l);
+VTable::VTable(const char *l, const char * const *m, int n)
+  : Instruction(TacVTable), methodLabels(m) {
+  Assert((methodLabels != NULL || n == 0) && l != NULL);
+  label = l;
+  imm = n;
+}
+void VTable::Format(char *buf) const {
+  snprintf(buf, MaxTextLength, "VTable for class %s", label);
 }
 
 void VTable::Print() {
-  printf("VTable %s =\n", label);
-  for (int i = 0; i < methodLabels->NumElements(); i++) 
-    printf("\t%s,\n", methodLabels->Nth(i));
-  printf("; \n"); 
+  std::ostream& out = Compilation::Current()->Output();
+  out << "VTable " << label << " =\n";
+  for (int i = 0; i < imm; i++) 
+    out << "\t" << methodLabels[i] << ",\n";
+  out << "; \n"; 
 }
 void VTable::EmitSpecific(Mips *mips) {
-  mips->EmitVTable(label, methodLabels);
+  mips->EmitVTable(label, methodLabels, imm);
 }
@@ -17,6 +17,11 @@
  *
  * You may need to make changes/extensions to these classes
  * if you are working on IR optimization.
+ *
+ * Locations and instructions don't copy the names and labels they are
+ * given: those are interned (see intern.h), so they can be compared
+ * with ==. The CodeGenerator makes locations and instructions in the
+ * arena of the code unit they belong to and releases them together.
 
  */
 
@@ -66,36 +71,62 @@ class Location
 
   // base class from which all Tac instructions derived
   // has the interface for the 2 polymorphic messages: Print & Emit
+  // Every instruction also carries its opcode and its operands in a
+  // uniform form, so passes over the code can switch on the kind of
+  // instruction and walk its operands without knowing the subclass.
+  // The operands are all an instruction holds: its TAC text is only
+  // rendered (by Format) when it is printed or commented into the
+  // assembly.
   
 class Instruction {
+    public:
+    typedef enum { TacDiscardValue, TacLoadConstant, TacLoadStringConstant,
+                   TacLoadLabel, TacAssign, TacLoad, TacStore, TacBinaryOp,
+                   TacLabel, TacGoto, TacIfZ, TacBeginFunc, TacEndFunc,
+                   TacReturn, TacPushParam, TacPopParams, TacLCall, TacACall,
+                   TacVTable } Opcode;
+
+    static const int MaxTextLength = 128; // buffer size for Format
+
     protected:
-      char printed[128];
+      Location *def;         // variable written, NULL if none
+      Location *uses[2];     // variables read, uses[0] first
+      const char *label;     // label/string operand, NULL if none
+      int imm;               // constant, offset, byte count or BinaryOp code
+      unsigned char opcode;  // an Opcode
+      unsigned char numUses;
+
+      Instruction(Opcode op, Location *def = NULL,
+                  Location *use0 = NULL, Location *use1 = NULL);
 	  
     public:
 	virtual void Print();
 	virtual void EmitSpecific(Mips *mips) = 0;
 	void Emit(Mips *mips);
-    /* -----------------------------*/
-    char* getPrinted() { 
-        return printed;
-    }
-    Location* varA;
-    Location* varB;
-    Location* varC;
-
-    int numVars;
-
-    /*
-    int num_vars() {
-        if ((varA_name != NULL) && (varB_name != NULL)) {
-            return 2;
-        }
-        else if ((varA_name != NULL) || (varB_name != NULL)) {
-            return 1;
-        }
-        else return 0;
-    }
-    */
+
+        // Writes the TAC text of the instruction (at most MaxTextLength
+        // chars including the nul) into buf; empty if it has none.
+    virtual void Format(char *buf) const { *buf = '\0'; }
+
+    Opcode GetOpcode() const          { return (Opcode)opcode; }
+    bool IsCall() const               { return opcode == TacLCall || opcode == TacACall; }
+
+        // Operands as seen by the dataflow analyses: the variable this
+        // instruction writes (NULL if none) and the variables it reads.
+        // GetUses fills in uses[] (room for 2) and returns the count.
+    Location *GetDef() const          { return def; }
+    int NumUses() const               { return numUses; }
+    Location *GetUse(int i) const     { return uses[i]; }
+    int GetUses(Location *out[]) const;
+
+        // The other operands, as stored: the label or string (NULL if
+        // none) and the constant, offset or count (see above)
+    const char *GetLabel() const      { return label; }
+    int GetImm() const                { return imm; }
+
+        // Target label of a Goto or IfZ, NULL for anything else
+    const char *GetBranchTarget() const
+        { return (opcode == TacGoto || opcode == TacIfZ) ? label : NULL; }
 };
 
   
@@ -125,7 +156,6 @@ class Instruction {
   class DiscardValue;
 
 class DiscardValue: public Instruction {
-    Location *dst;
   public:
     DiscardValue(Location *dst);
     void EmitSpecific(Mips *mips);
@@ -133,50 +163,45 @@ class DiscardValue: public Instruction {
 
 
 class LoadConstant: public Instruction {
-    Location *dst;
-    int val;
   public:
     LoadConstant(Location *dst, int val);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class LoadStringConstant: public Instruction {
-    Location *dst;
-    char *str;
   public:
     LoadStringConstant(Location *dst, const char *s);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
     
 class LoadLabel: public Instruction {
-    Location *dst;
-    const char *label;
   public:
     LoadLabel(Location *dst, const char *label);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class Assign: public Instruction {
-    Location *dst, *src;
   public:
     Assign(Location *dst, Location *src);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class Load: public Instruction {
-    Location *dst, *src;
-    int offset;
   public:
     Load(Location *dst, Location *src, int offset = 0);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class Store: public Instruction {
-    Location *dst, *src;
-    int offset;
   public:
     Store(Location *d, Location *s, int offset = 0);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class BinaryOp: public Instruction {
@@ -186,16 +211,12 @@ class BinaryOp: public Instruction {
     static const char * const opName[NumOps];
     static OpCode OpCodeForName(const char *name);
     
-  protected:
-    OpCode code;
-    Location *dst, *op1, *op2;
-  public:
     BinaryOp(OpCode c, Location *dst, Location *op1, Location *op2);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class Label: public Instruction {
-    const char *label;
   public:
     Label(const char *label);
     void Print();
@@ -204,80 +225,77 @@ class Label: public Instruction {
 };
 
 class Goto: public Instruction {
-    const char *label;
   public:
     Goto(const char *label);
     void EmitSpecific(Mips *mips);
-    const char* branch_label() const { return label; }
+    void Format(char *buf) const;
 };
 
 class IfZ: public Instruction {
-    Location *test;
-    const char *label;
   public:
     IfZ(Location *test, const char *label);
     void EmitSpecific(Mips *mips);
-    const char* branch_label() const { return label; }
+    void Format(char *buf) const;
 };
 
 class BeginFunc: public Instruction {
-    int frameSize;
   public:
     BeginFunc();
     // used to backpatch the instruction with frame size once known
     void SetFrameSize(int numBytesForAllLocalsAndTemps);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class EndFunc: public Instruction {
   public:
     EndFunc();
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class Return: public Instruction {
-    Location *val;
   public:
     Return(Location *val);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };   
 
 class PushParam: public Instruction {
-    Location *param;
   public:
     PushParam(Location *param);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 }; 
 
 class PopParams: public Instruction {
-    int numBytes;
   public:
     PopParams(int numBytesOfParamsToRemove);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 }; 
 
 class LCall: public Instruction {
-    const char *label;
-    Location *dst;
   public:
     LCall(const char *labe, Location *result);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class ACall: public Instruction {
-    Location *dst, *methodAddr;
   public:
     ACall(Location *meth, Location *result);
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 class VTable: public Instruction {
-    List<const char *> *methodLabels;
-    const char *label;
+    const char * const *methodLabels; // imm of them
  public:
-    VTable(const char *labelForTable, List<const char *> *methodLabels);
+    VTable(const char *labelForTable, const char * const *methodLabels, int numMethods);
     void Print();
     void EmitSpecific(Mips *mips);
+    void Format(char *buf) const;
 };
 
 
@@ -0,0 +1,67 @@
+/* File: taskpool.cc
+ * -----------------
+ * Implementation of RunTasks.
+ */
+
+#include "taskpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Struct: Pool
+ * ------------
+ * What the workers share: the next task nobody has claimed yet and
+ * which tasks are done, guarded by lock.
+ */
+struct Pool {
+    TaskBatch *batch;
+    int numTasks;
+    std::atomic<int> next;
+    std::vector<bool> done;
+    std::mutex lock;
+    std::condition_variable finished;
+};
+
+static void Work(Pool *pool)
+{
+    for (int task = pool->next++; task < pool->numTasks; task = pool->next++) {
+        pool->batch->Do(task);
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->done[task] = true;
+        pool->finished.notify_all();
+    }
+}
+
+void RunTasks(TaskBatch *batch, int numTasks, int numThreads)
+{
+    if (numThreads > numTasks) numThreads = numTasks;
+    if (numThreads <= 1) {
+        for (int task = 0; task < numTasks; task++) {
+            batch->Do(task);
+            batch->Finish(task);
+        }
+        return;
+    }
+
+    Pool pool;
+    pool.batch = batch;
+    pool.numTasks = numTasks;
+    pool.next = 0;
+    pool.done.assign(numTasks, false);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numThreads; i++)
+        workers.push_back(std::thread(Work, &pool));
+
+    for (int task = 0; task < numTasks; task++) {
+        {
+            std::unique_lock<std::mutex> guard(pool.lock);
+            while (!pool.done[task])
+                pool.finished.wait(guard);
+        }
+        batch->Finish(task);
+    }
+    for (int i = 0; i < numThreads; i++)
+        workers[i].join();
+}
@@ -0,0 +1,35 @@
+/* File: taskpool.h
+ * ----------------
+ * Runs a batch of independent tasks, numbered 0..n-1, on a few worker
+ * threads while the calling thread takes the results in task order.
+ *
+ * Workers claim tasks lowest number first from one shared counter, so
+ * a thread that finishes a short task just takes the next one and no
+ * thread sits idle while work is left, however uneven the tasks are.
+ * The caller gets Finish(i) as soon as task i and all the tasks before
+ * it are done, so results can be written out in order while the rest
+ * are still being worked on, and need not all be held until the end.
+ *
+ *   class Translate : public TaskBatch {
+ *       void Do(int i)     { ... work on item i, keep its result ... }
+ *       void Finish(int i) { ... write out the result of item i ... }
+ *   };
+ *   RunTasks(&translate, numItems, numThreads);
+ *
+ * With one thread (or one task) everything runs on the calling thread.
+ */
+
+#ifndef _H_taskpool
+#define _H_taskpool
+
+class TaskBatch
+{
+  public:
+    virtual ~TaskBatch() {}
+    virtual void Do(int task) = 0;       // on some worker thread
+    virtual void Finish(int task) = 0;   // on the calling thread, in order
+};
+
+void RunTasks(TaskBatch *batch, int numTasks, int numThreads);
+
+#endif
@@ -0,0 +1,203 @@
+/* File: timing.cc
+ * ---------------
+ * Implementation of phase timing: the spans open on each thread, the
+ * report and the trace.
+ */
+
+#include "timing.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <sys/resource.h>
+#include "compilation.h"
+
+bool allocationsCounted = false;
+
+  // Allocations made on this thread so far (plain data, so they can be
+  // counted from operator new before anything else is set up)
+static thread_local long threadAllocations, threadBytes;
+
+void CountAllocation(size_t bytes)
+{
+    threadAllocations++;
+    threadBytes += bytes;
+}
+
+
+static const char * const phaseName[NumPhases] = {
+    "scan/parse", "check", "tac", "cfg", "dataflow", "regalloc", "emit" };
+
+/* Struct: OpenSpan
+ * ----------------
+ * A span begun and not yet ended, with what its nested spans have
+ * used so far, to charge it for the rest.
+ */
+struct OpenSpan {
+    Timings::Span span;
+    long startAllocations, startBytes;
+    long long nestedTime;
+    long nestedAllocations, nestedBytes;
+};
+
+static thread_local std::vector<OpenSpan> openSpans;
+static thread_local int threadNumber = -1;
+static std::atomic<int> nextThreadNumber(0);
+
+static Timings *CurrentTimings()
+{
+    Compilation *c = Compilation::Current();
+    return c ? c->GetTimings() : NULL;
+}
+
+static long PeakRSS()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;  // in KB on Linux
+}
+
+void BeginPhase(Phase phase, const char *function)
+{
+    Timings *timings = CurrentTimings();
+    if (!timings) return;
+    if (threadNumber < 0) threadNumber = nextThreadNumber++;
+
+    OpenSpan open;
+    open.span.phase = phase;
+    open.span.function = (function || openSpans.empty()) ? function : openSpans.back().span.function;
+    open.span.thread = threadNumber;
+    open.nestedTime = 0;
+    open.nestedAllocations = open.nestedBytes = 0;
+    openSpans.push_back(open);
+    OpenSpan& added = openSpans.back();
+    added.startAllocations = threadAllocations;
+    added.startBytes = threadBytes;
+    added.span.start = timings->Now();
+}
+
+void EndPhase(Phase phase)
+{
+    Timings *timings = CurrentTimings();
+    if (!timings || openSpans.empty() || openSpans.back().span.phase != phase) return;
+    long long now = timings->Now();
+    long allocations = threadAllocations - openSpans.back().startAllocations;
+    long bytes = threadBytes - openSpans.back().startBytes;
+
+    OpenSpan open = openSpans.back();
+    openSpans.pop_back();
+    Timings::Span& span = open.span;
+    span.duration = now - span.start;
+    span.self = span.duration - open.nestedTime;
+    span.allocations = allocations - open.nestedAllocations;
+    span.bytes = bytes - open.nestedBytes;
+    span.peakKB = PeakRSS();
+    if (!openSpans.empty()) {
+        OpenSpan& outer = openSpans.back();
+        outer.nestedTime += span.duration;
+        outer.nestedAllocations += allocations;
+        outer.nestedBytes += bytes;
+    }
+    timings->Record(span);
+}
+
+
+static long long Clock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Timings::Timings() : start(Clock()) {}
+
+long long Timings::Now() const
+{
+    return Clock() - start;
+}
+
+void Timings::Record(const Span& span)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    spans.push_back(span);
+}
+
+
+/* Method: WriteReport
+ * -------------------
+ * One line per phase. The per-function phases may run on several
+ * threads at once, so their times are summed over the functions and
+ * can add up to more than the total.
+ */
+void Timings::WriteReport(std::ostream& out)
+{
+    long long time[NumPhases] = {0};
+    long count[NumPhases] = {0}, allocations[NumPhases] = {0}, bytes[NumPhases] = {0};
+    long peakKB[NumPhases] = {0};
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < spans.size(); i++) {
+            Phase p = spans[i].phase;
+            time[p] += spans[i].self;
+            count[p]++;
+            allocations[p] += spans[i].allocations;
+            bytes[p] += spans[i].bytes;
+            if (spans[i].peakKB > peakKB[p]) peakKB[p] = spans[i].peakKB;
+        }
+    }
+
+    char line[160];
+    out << "Time report (per-function phases summed over functions):" << std::endl;
+    sprintf(line, "  %-12s %10s %8s %12s %12s %12s", "phase", "wall ms", "spans",
+            "allocs", "alloc KB", "peak RSS KB");
+    out << line << std::endl;
+    for (int p = 0; p < NumPhases; p++) {
+        if (count[p] == 0) continue;
+        if (allocationsCounted)
+            sprintf(line, "  %-12s %10.2f %8ld %12ld %12ld %12ld", phaseName[p], time[p]/1e6,
+                    count[p], allocations[p], bytes[p]/1024, peakKB[p]);
+        else
+            sprintf(line, "  %-12s %10.2f %8ld %12s %12s %12ld", phaseName[p], time[p]/1e6,
+                    count[p], "-", "-", peakKB[p]);
+        out << line << std::endl;
+    }
+    sprintf(line, "  %-12s %10.2f %8s %12s %12s %12ld", "total", Now()/1e6, "", "", "", PeakRSS());
+    out << line << std::endl;
+}
+
+static void WriteJsonString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < ' ') fprintf(f, "\\u%04x", *s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+/* Method: WriteTrace
+ * ------------------
+ * Each span is a complete ("X") event on the timeline of the thread
+ * it ran on, with the function, if any, and what it allocated as its
+ * arguments. Returns false if the file can't be written.
+ */
+bool Timings::WriteTrace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    std::lock_guard<std::mutex> guard(lock);
+    fprintf(f, "{\"traceEvents\": [\n");
+    for (size_t i = 0; i < spans.size(); i++) {
+        const Span& s = spans[i];
+        fprintf(f, "  {\"name\": ");
+        WriteJsonString(f, s.function ? s.function : phaseName[s.phase]);
+        fprintf(f, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"phase\": \"%s\"",
+                phaseName[s.phase], s.thread, s.start/1e3, s.duration/1e3, phaseName[s.phase]);
+        if (allocationsCounted)
+            fprintf(f, ", \"allocations\": %ld, \"bytes\": %ld", s.allocations, s.bytes);
+        fprintf(f, ", \"peakKB\": %ld}}%s\n", s.peakKB, i + 1 < spans.size() ? "," : "");
+    }
+    fprintf(f, "], \"displayTimeUnit\": \"ms\"}\n");
+    bool ok = !ferror(f);
+    return (fclose(f) == 0) && ok;
+}
@@ -0,0 +1,90 @@
+/* File: timing.h
+ * --------------
+ * Timing of the compiler's phases, for --time-report and --trace=<file>
+ * (see DecafOptions). The code marks out the spans of time it spends
+ * in each phase, naming the function for the phases that run once per
+ * function:
+ *
+ *   BeginPhase(CfgPhase, unit->GetName());
+ *   ControlFlowGraph cfg(*unit);
+ *   EndPhase(CfgPhase);
+ *
+ * or, for a span that is a whole block,
+ *
+ *   { PhaseTimer timer(CheckPhase); ... }
+ *
+ * Spans nest: register allocation includes the liveness analysis it
+ * runs, say. A nested span without a function name takes the one of
+ * the span around it, and each phase is charged only for its time
+ * outside the spans nested in it. Spans are kept per thread, so the
+ * back end's threads can each time their own functions.
+ *
+ * The report gives each phase's time, the allocations made in it and
+ * the peak RSS at its end; the trace is every span, in the Chrome
+ * trace event format (load it in chrome://tracing or Perfetto).
+ * Allocations are counted only in dcc, which links in a counting
+ * operator new (allocstats.cc); a program using libdecaf keeps its own.
+ *
+ * When neither option is on, the current compilation has no Timings
+ * and these calls do nothing but check for it.
+ */
+
+#ifndef _H_timing
+#define _H_timing
+
+#include <stddef.h>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+enum Phase { ParsePhase, CheckPhase, TacPhase, CfgPhase, DataflowPhase,
+             RegAllocPhase, EmitPhase, NumPhases };
+
+void BeginPhase(Phase phase, const char *function = NULL);
+void EndPhase(Phase phase);  // ends this thread's innermost span if it is of phase
+
+class PhaseTimer
+{
+  public:
+    PhaseTimer(Phase phase, const char *function = NULL) : phase(phase)
+        { BeginPhase(phase, function); }
+    ~PhaseTimer()                 { EndPhase(phase); }
+
+  private:
+    Phase phase;
+};
+
+
+class Timings
+{
+  public:
+    struct Span {
+        Phase phase;
+        const char *function;     // interned, NULL if none
+        int thread;               // numbered from 0 in order of first use
+        long long start, duration; // in ns from the start of the compilation
+        long long self;           // duration less that of nested spans
+        long allocations, bytes;  // made in the span but not nested ones
+        long peakKB;              // peak RSS of the process at its end
+    };
+
+    Timings();
+
+    long long Now() const;        // ns since the start
+    void Record(const Span& span);
+
+    void WriteReport(std::ostream& out);
+    bool WriteTrace(const char *path);
+
+  private:
+    long long start;
+    std::mutex lock;
+    std::vector<Span> spans;
+};
+
+
+  // Called by the counting operator new (allocstats.cc), if linked in
+void CountAllocation(size_t bytes);
+extern bool allocationsCounted;
+
+#endif
@@ -0,0 +1,277 @@
+/* File: unitcache.cc
+ * ------------------
+ * Implementation of UnitCache.
+ *
+ * The numbered names in a key and in the assembly stored with it are
+ * written relative to the key's bases, as Marker, a letter for the
+ * series, the number of digits, ',', the relative number and ';'
+ * (a Marker already in the text is doubled). The back end only ever
+ * copies names through, so the assembly for a unit whose names are all
+ * shifted is the stored assembly with its names shifted the same way.
+ * The digit counts are kept because a longer name lines up differently
+ * in a padded column; with them in the key a hit is exact to the byte.
+ */
+
+#include "unitcache.h"
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codeunit.h"
+#include "tac.h"
+#include "utility.h"
+
+static const char * const seriesPrefix[UnitCache::NumSeries] = { "_L", "_tmp", "_string" };
+static const char seriesTag[UnitCache::NumSeries] = { 'L', 'T', 'S' };
+static const char Marker = '\001';
+static const char * const KeyVersion = "dcc unit cache 1\n"; // bump when the assembly changes
+
+  // Numbers the temporary files of every cache in the process, so that
+  // compilations running at once never write to the same one
+static std::atomic<int> nextTempFile(0);
+
+
+/* Function: NumberedNameAt
+ * ------------------------
+ * If s has one of the numbered names at i, returns its series and sets
+ * number and end (the index just past it), else returns -1. Numbers
+ * with leading zeros or too many digits to shift are left alone, as
+ * they can't be ours.
+ */
+static int NumberedNameAt(const std::string& s, size_t i, int *number, size_t *end)
+{
+    if (s[i] != '_') return -1;
+    for (int k = 0; k < UnitCache::NumSeries; k++) {
+        size_t digits = i + strlen(seriesPrefix[k]), e = digits;
+        if (s.compare(i, digits - i, seriesPrefix[k]) != 0) continue;
+        while (e < s.size() && s[e] >= '0' && s[e] <= '9') e++;
+        if (e == digits || e - digits > 9 || (s[digits] == '0' && e - digits > 1))
+            return -1;
+        *number = atoi(s.c_str() + digits);
+        *end = e;
+        return k;
+    }
+    return -1;
+}
+
+static bool HasNumberedName(const std::string& s)
+{
+    int number;
+    size_t end;
+    for (size_t i = 0; i < s.size(); i++)
+        if (NumberedNameAt(s, i, &number, &end) >= 0) return true;
+    return false;
+}
+
+static void MakeRelative(const std::string& s, const int base[], std::string *out)
+{
+    char buf[32];
+    for (size_t i = 0; i < s.size(); ) {
+        int number;
+        size_t end;
+        int k = NumberedNameAt(s, i, &number, &end);
+        if (k >= 0) {
+            sprintf(buf, "%c%c%d,%d;", Marker, seriesTag[k], (int)(end - i - strlen(seriesPrefix[k])),
+                    number - base[k]);
+            *out += buf;
+            i = end;
+        } else {
+            if (s[i] == Marker) *out += Marker;
+            *out += s[i++];
+        }
+    }
+}
+
+/* Function: MakeAbsolute
+ * ----------------------
+ * The reverse of MakeRelative, against new bases. Returns false if
+ * the text is damaged or a name comes out longer or shorter than it
+ * was keyed with.
+ */
+static bool MakeAbsolute(const char *s, const char *end, const int base[], std::string *out)
+{
+    char buf[32];
+    while (s < end) {
+        const char *marker = (const char *)memchr(s, Marker, end - s);
+        if (!marker) marker = end;
+        out->append(s, marker);
+        if (marker == end) break;
+        if (marker + 1 < end && marker[1] == Marker) {
+            *out += Marker;
+            s = marker + 2;
+            continue;
+        }
+        const char *tag = marker + 1;
+        const char *found = tag < end ? (const char *)memchr(seriesTag, *tag, UnitCache::NumSeries) : NULL;
+        const char *stop = (const char *)memchr(tag, ';', end - tag);
+        if (!found || !stop) return false;
+        int k = found - seriesTag, digits, relative;
+        if (sscanf(tag + 1, "%d,%d", &digits, &relative) != 2) return false;
+        int len = sprintf(buf, "%s%d", seriesPrefix[k], relative + base[k]);
+        if (len - (int)strlen(seriesPrefix[k]) != digits) return false;
+        *out += buf;
+        s = stop + 1;
+    }
+    return true;
+}
+
+
+static void AppendString(std::string *s, const char *text)
+{
+    char buf[32];
+    if (!text) { *s += " ~"; return; }
+    sprintf(buf, " %d:", (int)strlen(text));
+    *s += buf;
+    *s += text;
+}
+
+/* Function: AppendLocation
+ * ------------------------
+ * A variable is written out in full the first time it is used and by
+ * number after that, so the key also says which operands are the
+ * same variable (the back end goes by identity).
+ */
+static void AppendLocation(std::string *s, Location *var, std::map<Location*, int> *seen)
+{
+    char buf[64];
+    if (!var) { *s += " -"; return; }
+    std::map<Location*, int>::iterator found = seen->find(var);
+    if (found != seen->end()) {
+        sprintf(buf, " #%d", found->second);
+        *s += buf;
+        return;
+    }
+    int n = seen->size();
+    (*seen)[var] = n;
+    sprintf(buf, " #%d=", n);
+    *s += buf;
+    AppendString(s, var->GetName());
+    sprintf(buf, " %d %d", var->GetSegment(), var->GetOffset());
+    *s += buf;
+    if (var->IsReference()) {
+        sprintf(buf, " ref %d", var->GetRefOffset());
+        *s += buf;
+        AppendLocation(s, var->GetBase(), seen);
+    }
+}
+
+
+UnitCache::UnitCache(const std::string& dir) : dir(dir), hits(0), misses(0)
+{
+    mkdir(dir.c_str(), 0777);  // if it's not there; if we can't, everything misses
+}
+
+/* Method: MakeKey
+ * ---------------
+ * Only functions are cached (the rest is cheap to translate). A unit
+ * with a string constant that looks like a numbered name is not: the
+ * TAC comments cut long strings short, which could cut such a name
+ * and leave one that can't be renumbered.
+ */
+bool UnitCache::MakeKey(CodeUnit *unit, int firstString, Key *key) const
+{
+    if (!unit->IsFunction()) return false;
+
+    char buf[64];
+    std::string raw;
+    std::map<Location*, int> seen;
+    int numStrings = 0;
+    for (CodeUnit::Position p = unit->First(); p != CodeUnit::End; p = unit->Next(p)) {
+        Instruction *instr = unit->At(p);
+        if (instr->GetOpcode() == Instruction::TacLoadStringConstant) {
+            if (HasNumberedName(instr->GetLabel())) return false;
+            numStrings++;
+        }
+        sprintf(buf, "%d %d", instr->GetOpcode(), instr->GetImm());
+        raw += buf;
+        AppendString(&raw, instr->GetLabel());
+        AppendLocation(&raw, instr->GetDef(), &seen);
+        for (int i = 0; i < instr->NumUses(); i++)
+            AppendLocation(&raw, instr->GetUse(i), &seen);
+        raw += '\n';
+    }
+
+    for (int k = 0; k < NumSeries; k++) key->base[k] = -1;
+    for (size_t i = 0; i < raw.size(); i++) {
+        int number;
+        size_t end;
+        int k = NumberedNameAt(raw, i, &number, &end);
+        if (k >= 0 && (key->base[k] < 0 || number < key->base[k])) key->base[k] = number;
+    }
+    for (int k = 0; k < NumSeries; k++)
+        if (key->base[k] < 0) key->base[k] = 0;
+    key->base[Strings] = firstString;
+
+    key->text = KeyVersion;
+    sprintf(buf, "O%d lean%d strings", OptimizationLevel(), LeanAssembly());
+    key->text += buf;
+    for (int i = 0; i < numStrings; i++) { // the digits of the string labels
+        int digits = sprintf(buf, "%d", firstString + i);
+        sprintf(buf, " %d", digits);
+        key->text += buf;
+    }
+    key->text += '\n';
+    MakeRelative(raw, key->base, &key->text);
+    return true;
+}
+
+std::string UnitCache::PathFor(const std::string& keyText) const
+{
+    unsigned long long hash = 14695981039346656037ULL;   // 64-bit FNV-1a
+    for (size_t i = 0; i < keyText.size(); i++) {
+        hash ^= (unsigned char)keyText[i];
+        hash *= 1099511628211ULL;
+    }
+    char name[32];
+    sprintf(name, "/%016llx", hash);
+    return dir + name;
+}
+
+bool UnitCache::Find(const Key& key, std::string *text)
+{
+    std::string entry;
+    FILE *f = fopen(PathFor(key.text).c_str(), "rb");
+    if (f) {
+        char buf[1 << 14];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            entry.append(buf, n);
+        fclose(f);
+    }
+
+    // an entry is the length of the key, a newline, the key and the text
+    size_t keyLength = strtoul(entry.c_str(), NULL, 10);
+    size_t start = entry.find('\n') + 1;
+    if (start == 0 || keyLength != key.text.size()
+        || entry.compare(start, keyLength, key.text) != 0) {
+        misses++;
+        return false;
+    }
+    const char *stored = entry.data() + start + keyLength;
+    text->clear();
+    if (!MakeAbsolute(stored, entry.data() + entry.size(), key.base, text)) {
+        misses++;
+        return false;
+    }
+    hits++;
+    return true;
+}
+
+void UnitCache::Save(const Key& key, const std::string& text)
+{
+    char header[32];
+    sprintf(header, "%d\n", (int)key.text.size());
+    std::string entry = header + key.text;
+    MakeRelative(text, key.base, &entry);
+
+    std::string path = PathFor(key.text);
+    sprintf(header, ".%d.%d", (int)getpid(), nextTempFile++);
+    std::string temp = path + header;
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f) return;
+    bool written = fwrite(entry.data(), 1, entry.size(), f) == entry.size();
+    if (fclose(f) != 0 || !written || rename(temp.c_str(), path.c_str()) != 0)
+        unlink(temp.c_str());
+}
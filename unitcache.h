@@ -0,0 +1,72 @@
+/* File: unitcache.h
+ * -----------------
+ * An on-disk cache of the assembly for functions, so that compiling a
+ * program again after changing a few of its functions runs the back
+ * end (CFG, liveness, register allocation) over the changed ones only.
+ *
+ * An entry is addressed by the content of the function's code unit:
+ * each instruction with all its operands and each variable with its
+ * segment and offset. The class layout a function depends on is in
+ * there too, since field and vtable offsets are constants in its TAC.
+ * The options that change the assembly are part of the key as well.
+ *
+ * The names numbered across the whole program (labels _L<n>, temps
+ * _tmp<n> and strings _string<n>) are keyed relative to the function's
+ * first one, and the stored assembly is renumbered to fit on a hit, so
+ * an edit earlier in the program that shifts the numbering does not
+ * invalidate everything after it.
+ *
+ * The key is hashed to name the entry's file, and the whole key is kept
+ * in the entry and compared on lookup, so a hash collision is only a
+ * miss. Entries are written to a temporary file and renamed into place,
+ * so compilers sharing the directory never see half an entry. A cache
+ * directory that cannot be read or written just misses.
+ *
+ *   UnitCache::Key key;
+ *   bool cached = cache.MakeKey(unit, firstString, &key);
+ *   if (!cached || !cache.Find(key, &text)) {
+ *       ... translate the unit into text ...
+ *       if (cached) cache.Save(key, text);
+ *   }
+ *
+ * Find and Save can be called from several threads at once.
+ */
+
+#ifndef _H_unitcache
+#define _H_unitcache
+
+#include <atomic>
+#include <string>
+class CodeUnit;
+
+class UnitCache
+{
+  public:
+    enum Series { Labels, Temps, Strings, NumSeries }; // numbered names
+
+    class Key {
+        friend class UnitCache;
+        std::string text;       // with the numbered names made relative
+        int base[NumSeries];    // the numbers they are relative to
+    };
+
+    UnitCache(const std::string& dir);
+
+          // Returns false if the unit can't be cached (see MakeKey in
+          // unitcache.cc); firstString is the number of its first
+          // string constant, as given to Mips.
+    bool MakeKey(CodeUnit *unit, int firstString, Key *key) const;
+    bool Find(const Key& key, std::string *text);
+    void Save(const Key& key, const std::string& text);
+
+    int NumHits() const           { return hits; }
+    int NumMisses() const         { return misses; }
+
+  private:
+    std::string dir;
+    std::atomic<int> hits, misses;
+
+    std::string PathFor(const std::string& keyText) const;
+};
+
+#endif
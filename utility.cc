@@ -6,10 +6,10 @@
 
 #include "utility.h"
 #include <stdarg.h>
-#include "list.h"
 #include <string.h>
+#include <thread>
+#include "compilation.h"
 
-static List<const char*> debugKeys;
 static const int BufferSize = 2048;
 
 void Failure(const char *format, ...)
@@ -20,6 +20,7 @@ void Failure(const char *format, ...)
   va_start(args, format);
   vsprintf(errbuf, format, args);
   va_end(args);
+  if (Compilation::Current()) Compilation::Current()->Output().flush();
   fflush(stdout);
   fprintf(stderr,"\n*** Failure: %s\n\n", errbuf);
   abort();
@@ -27,26 +28,10 @@ void Failure(const char *format, ...)
 
 
 
-int IndexOf(const char *key)
-{
-   for (int i = 0; i < debugKeys.NumElements(); i++)
-      if (!strcmp(debugKeys.Nth(i), key)) return i;
-   return -1;
-}
-
 bool IsDebugOn(const char *key)
 {
-   return (IndexOf(key) != -1);
-}
-
-
-void SetDebugForKey(const char *key, bool value)
-{
-  int k = IndexOf(key);
-  if (!value && k != -1)
-    debugKeys.RemoveAt(k);
-  else if (value && k == -1)
-    debugKeys.Append(key);
+   Compilation *c = Compilation::Current();
+   return c && c->IsDebugOn(key);
 }
 
 
@@ -62,21 +47,62 @@ void PrintDebug(const char *key, const char *format, ...)
   va_start(args, format);
   vsprintf(buf, format, args);
   va_end(args);
-  printf("+++ (%s): %s%s", key, buf, buf[strlen(buf)-1] != '\n'? "\n" : "");
+  Compilation::Current()->Output() << "+++ (" << key << "): " << buf
+                                    << (buf[strlen(buf)-1] != '\n'? "\n" : "");
 }
 
 
-void ParseCommandLine(int argc, char *argv[])
+int OptimizationLevel()
+{
+  return Compilation::Current()->Options().optLevel;
+}
+
+bool LeanAssembly()
 {
-  if (argc == 1)
+  return Compilation::Current()->Options().leanAsm;
+}
+
+int NumThreads()
+{
+  int n = Compilation::Current()->Options().numThreads;
+  if (n <= 0) n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+
+void ParseCommandLine(int argc, char *argv[], DecafOptions *options, const char **sourceFile)
+{
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-O", 2) == 0)
+      options->optLevel = atoi(argv[i] + 2);
+    else if (strncmp(argv[i], "-j", 2) == 0)
+      options->numThreads = atoi(argv[i] + 2);
+    else if (strcmp(argv[i], "--lean-asm") == 0)
+      options->leanAsm = true;
+    else if (strncmp(argv[i], "--cache-dir=", 12) == 0)
+      options->cacheDir = argv[i] + 12;
+    else if (strcmp(argv[i], "--time-report") == 0)
+      options->timeReport = true;
+    else if (strcmp(argv[i], "--flat-ast") == 0)
+      options->flatAst = true;
+    else if (strncmp(argv[i], "--trace=", 8) == 0)
+      options->traceFile = argv[i] + 8;
+    else if (argv[i][0] != '-' && !*sourceFile)
+      *sourceFile = argv[i];
+    else
+      break;
+  }
+
+  if (i == argc)
     return;
   
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
+  if (strcmp(argv[i], "-d") != 0) { // next arg is not -d
+    printf("Usage:   [-O<level>] [-j<threads>] [--lean-asm] [--cache-dir=<dir>] [--time-report] [--flat-ast] [--trace=<file>] [<file>] -d <debug-key-1> <debug-key-2> ... \n");
     exit(2);
   }
 
-  for (int i = 2; i < argc; i++)
-    SetDebugForKey(argv[i], true);
+  for (i++; i < argc; i++)
+    options->debugKeys.push_back(argv[i]);
 }
 
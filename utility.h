@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+struct DecafOptions;
 
 
 /* Function: Failure()
@@ -45,23 +46,14 @@ void Failure(const char *format, ...);
  * -------------------------------------------------------
  * Print a message if we have turned debugging messages on for the given
  * key.  For example, the usage line shown above will only print a message
- * if the call is preceded by a call to SetDebugForKey("parser",true).
- * The function accepts printf arguments.  The provided main.cc parses
- * the command line to turn on debug flags. 
+ * if "parser" is among the debug keys in the options of the current
+ * compilation (see compilation.h). The function accepts printf
+ * arguments.  The provided main.cc parses the command line to turn on
+ * debug flags. 
  */
 void PrintDebug(const char *key, const char *format, ...);
 
 
-/* Function: SetDebugForKey()
- * Usage: SetDebugForKey("scope", true);
- * -------------------------------------
- * Turn on debugging messages for the given key.  See PrintDebug
- * for an example. Can be called manually when desired and will
- * be called from the provided main for flags passed with -d.
- */
-void SetDebugForKey(const char *key, bool val);
-
-
 /* Function: IsDebugOn()
  * Usage: if (IsDebugOn("scope")) ...
  * ----------------------------------
@@ -72,12 +64,46 @@ bool IsDebugOn(const char *key);
 
 
 
+/* Function: OptimizationLevel()
+ * Usage: if (OptimizationLevel() >= 2) ...
+ * ----------------------------------------
+ * Returns the level given with -O<level> on the command line (in the
+ * options of the current compilation), 0 if none was given. Level 0
+ * uses the simple on-the-fly register handling in Mips, level 1 the
+ * linear scan register allocator and level 2 the graph coloring
+ * allocator (see regalloc.h).
+ */
+int OptimizationLevel();
+
+
+/* Function: LeanAssembly()
+ * Usage: if (!LeanAssembly()) ...
+ * -------------------------------
+ * Returns true if --lean-asm was given on the command line, in which
+ * case the assembly is written without any comments (no TAC text, no
+ * notes on registers and spills).
+ */
+bool LeanAssembly();
+
+
+/* Function: NumThreads()
+ * Usage: RunTasks(&batch, n, NumThreads());
+ * -----------------------------------------
+ * Returns how many threads the back end may translate functions on:
+ * the n given with -j<n>, or one per core if none was given.
+ */
+int NumThreads();
+
+
 /* Function: ParseCommandLine
  * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+ * Fill in the options from the command line.  Accepts the options
+ * -O<level>, -j<n>, --lean-asm, --cache-dir=<dir>, --time-report,
+ * --flat-ast and --trace=<file> and the name of the source file (in
+ * any order) and then -d, interpreting all the arguments that follow
+ * -d as being debugging flags to turn on. The file name is left NULL
+ * if none is given.
  */
-void ParseCommandLine(int argc, char *argv[]);
+void ParseCommandLine(int argc, char *argv[], DecafOptions *options, const char **sourceFile);
      
 #endif